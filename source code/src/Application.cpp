@@ -6,8 +6,10 @@
 
 //
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
+#include <sstream>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -21,15 +23,22 @@
 
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 #include "Application.h"
 
+#include "Bench.h"
 #include "Buffers.h"
 #include "Canvas.h"
+#include "FrameData.h"
 #include "Lighting.h"
 #include "Materials.h"
 #include "Models.h"
+#include "Profile.h"
+#include "Scene.h"
 #include "ShaderSetup.h"
+#include "Textures.h"
 #include "Types.h"
 #include "Utils.h"
 #include "Viewing.h"
@@ -49,99 +58,172 @@ static const char *fs_t = "texture.frag";
 // our Canvas
 static Canvas *canvas;
 
-// buffers for our shapes
+// buffers for our shapes, which share the buffers in the pool
 static BufferSet buffers[N_OBJECTS];
+static BufferPool pool;
 
 // shader program handles
 static GLuint phong, texture;
 
-// our VAO
-static GLuint vao;
-
 // do we need to do a display() call?
 static bool updateDisplay = true;
 
 // animation control
 static bool animating[N_OBJECTS];  // individual animation flags
-static float angles[N_OBJECTS];    // individual rotation angles
 
 // which object(s) to texture map
 static bool map_obj[N_OBJECTS];
 
-// object transformations
-
-static glm::vec3 cyl_s(     .45f,    .50f,   .65f);//scaling
-static glm::vec3 cyl_x(     1.5f,   0.5f,   .3f);//moving
-
-static glm::vec3 cyl2_s     (.45f, .65f, .65f);//scaling
-static glm::vec3 cyl2_x     (1.5f, 0.5f, .3f);//moving
-
-static glm::vec3 sph_s(     .6f,   .3f,    .3f);//scaling
-static glm::vec3 sph_x(     1.2f, 1.4f,   -1.6f);//moving
-
-static glm::vec3 sph2_s(    .7f, .5f, .5f);//scaling
-static glm::vec3 sph2_x(    .86f, 1.5f, -2.2f);//moving
-
-static glm::vec3 sph3_s(     .7f, .5f, .5f);//scaling
-static glm::vec3 sph3_x(   1.6f, 1.62f, -1.65f);//moving
-
-static glm::vec3 cube_s(    10.f,   10.f,   1.f);//scaling
-static glm::vec3 cube_x(    -1.25f, 1.5f,   -4.5f);//moving
-
-static glm::vec3 cube2_s(    10.f,    3.f,     15.f);//scaling
-static glm::vec3 cube2_x(   -1.25f, -1.5f,  -3.5f);//moving
-
-static glm::vec3 cube3_s(   4.f,    .75f,    3.f);   //scaling
-static glm::vec3 cube3_x(   0.0f,   0.5f,   -2.5f);  //moving
-
-static glm::vec3 semisph_s(     1.5f, 1.5f, 1.5f);//scaling
-static glm::vec3 semisph_x(     1.25f, 1.6f, -2.f);//moving
-
-static glm::vec3 prism_s(       2.5f,   1.25f, 1.0f);    //scaling
-static glm::vec3 prism_x(       -1.60f, -1.2f, 2.f);    //moving
-
-static glm::vec3 prism2_s(       2.5f, .07f, 1.0f);    //scaling
-static glm::vec3 prism2_x(      -1.60f, .1f, 2.f);    //moving
-
-static glm::vec3 plate_s(       1.51f, .19f, 2.51f);    //scaling
-static glm::vec3 plate_x(       0.45f, .02f, .5f);
-
-static glm::vec3 plate2_s       (1.5f, .2f, 2.5f);    //scaling
-static glm::vec3 plate2_x       (0.45f, .02f, .5f);
-
-static glm::vec3 bread1_s       (.81f, .159f,  .51f);    //scaling
-static glm::vec3 bread1_x       (-0.1f, .25f, .2f); //moving
-
-static glm::vec3 bread1a_s      (.80f, .16f, .50f);    //scaling
-static glm::vec3 bread1a_x      (-0.1f, .25f, .2f); //moving
-
-
-static glm::vec3 bread2_s       (.81f, .159f, .51f);    //scaling
-static glm::vec3 bread2_x       (-0.05f, .45f, .2f); //moving
-
-static glm::vec3 bread2a_s      (.8f, .16f, .5f);    //scaling
-static glm::vec3 bread2a_x      (-0.05f, .45f, .2f); //moving
-
-static glm::vec3 bread3_s       (1.f, .159f,.7f);    //scaling
-static glm::vec3 bread3_x       (0.7f, .25f, 1.0f); //moving
-
-static glm::vec3 bread3a_s      (.99f, .16f, .69f);    //scaling
-static glm::vec3 bread3a_x      (0.7f, .25f, 1.0f); //moving
-
-static glm::vec3 teapot_s       (2.1f, 2.8f, 2.1f);    //scaling
-static glm::vec3 teapot_x       (-.8f, .9f, -2.0f); //moving
-
-
-
-static glm::vec3 fork_s         (.08f, .08f, 0.01f);//scaling
-static glm::vec3 fork_x         (-1.1f, .3f, 1.2f);//moving
-
-static glm::vec3 cyl3_s         (1.f, .15f, 1.f);//scaling
-static glm::vec3 cyl3_x         (1.2f, 1.7f,-1.7f);//moving
+// which objects are drawn with the texture shader
+static bool textured[N_OBJECTS];
+
+// the object whose mesh each object draws
+static int meshOwner[N_OBJECTS];
+
+// draw objects which share a mesh, shader program, and texture
+// with one instanced draw?  (the GLSL 1.20 shaders can't)
+static bool instancing = true;
+
+// are the camera, projection, and lighting data in the shared
+// per-frame uniform buffer?  (the GLSL 1.20 shaders can't use it)
+static bool frameBlock = true;
+
+// objects grouped into batches which are each drawn with one
+// (possibly instanced) draw call
+static Object batchObjs[N_OBJECTS];
+static int batchFirst[N_OBJECTS], batchSize[N_OBJECTS];
+static int numBatches;
+
+// the render queue: batches in drawing order, sorted by shader
+// program, then texture, then mesh, so that each state change is
+// made only when that part of the sort key changes
+static int renderQueue[N_OBJECTS];
+static long batchKey[N_OBJECTS];
+
+// unit of the texture array used by each batch (-1 if it isn't textured)
+static GLint batchUnit[N_OBJECTS];
+
+// draw with glMultiDrawElementsIndirect() when we can?
+static bool multiDraw = false;
+
+// report GL errors through debug output?  (always in DEBUG builds;
+// otherwise, only with --gldebug, which main() also sees, so that
+// it can ask for a debug context)
+#if defined(DEBUG)
+static bool glDebug = true;
+#else
+static bool glDebug = false;
+#endif
 
-static glm::vec3 cyl4_s     (1.1f, 1.f, .8f);//scaling
-static glm::vec3 cyl4_x     (1.4f, .28f, .3f);//moving
+//
+// Multi-draw support
+//
+// All the objects drawn with one shader program and one texture array
+// are drawn with a single glMultiDrawElementsIndirect() call.  Each
+// object's transformation and material data live in a uniform block,
+// which the shaders index with the draw ID (offset by the index of the
+// call's first object).  The texture array is chosen per call, so a
+// sampler is never indexed by anything that varies within a draw.
+//
 
+// per-object data (must match ObjectData in the *430 shaders)
+typedef struct mdobject_s {
+    glm::mat4 modelViewMat;
+    glm::mat4 mvpMat;
+    glm::vec4 normalMat[3];     // a mat3, as std140 lays it out
+    glm::vec4 ambientColor;
+    glm::vec4 diffuseColor;
+    GLfloat specExp;
+    GLint layer;
+    GLint pad[2];
+} MDObject;
+
+static_assert( sizeof(MDObject) == 224, "MDObject must match std140" );
+
+// the shaders' limit on the number of objects (the size of the
+// objects[] array in the Objects block; the buffer must cover all of it)
+#define MD_MAX_OBJECTS  64
+
+// layout of a glMultiDrawElementsIndirect() command
+typedef struct mdcommand_s {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+} MDCommand;
+
+// shader programs, indexed by group: 0 textured, 1 Phong
+static const char *mdGroups[2] = { "textured", "phong" };
+static const char *mdShaders[2][2] = {
+    { "texture430.vert", "texture430.frag" },
+    { "p430.vert", "p430.frag" }
+};
+static GLuint mdPrograms[2];
+
+// object data and command buffers, and the objects in command order
+static GLuint mdObjects, mdCommands;
+static int mdOrder[N_OBJECTS];
+
+// one glMultiDrawElementsIndirect() call: a range of commands which
+// share a program (by group) and a texture array (by unit; -1 for the
+// Phong objects)
+typedef struct mddraw_s {
+    int group;
+    GLint unit;
+    int first, count;
+} MDDraw;
+
+// the calls, in program order
+static MDDraw mdDraws[N_OBJECTS];
+static int mdNumDraws;
+
+// run the vertex layout benchmark instead of the event loop?
+static bool benchLayout = false;
+
+// run the transformation benchmark instead of the event loop?
+static bool benchTransform = false;
+
+// where to write the profile trace (NULL if not profiling)
+static const char *profilePath = NULL;
+
+// render frames offscreen and report their timings instead?
+static bool benchFrame = false;
+static int benchCount = 500;
+
+// vertex data format for our shapes
+static Format vFormat = F_FLOAT;
+
+// use BC1-compressed textures, kept in the texture cache?
+static bool compressTextures = true;
+
+// how the textures are sampled
+static Sampler texSampler = repeatSampler;
+
+// how long each phase of the initialization took
+static ostringstream startupTimes;
+
+// the animation is simulated in fixed steps of this length (seconds),
+// independent of the frame rate, and never falls more than MAX_LAG
+// behind the clock (after a stall, it resumes rather than catching up)
+#define SIM_STEP    (1.0 / 60.0)
+#define MAX_LAG     0.25
+
+// the shortest time between frames while animating; the swap interval
+// normally paces them, but it may not be honored (and swaps may not
+// block), so the event loop also sleeps until the next frame is due.
+// It is above common refresh rates, so it doesn't hold back a display
+// which is pacing frames itself
+#define MIN_FRAME   (1.0 / 144.0)
+
+// the animated quantities
+typedef struct animstate_s {
+    float angles[N_OBJECTS];    // object rotation angles (degrees)
+    float lightX;               // light X position
+} AnimState;
+
+// the two most recent simulation steps; frames show a blend of them
+static AnimState simPrev, simCur;
 
 // light animation
 static bool animateLight = false;
@@ -185,6 +267,48 @@ static void args( const int argc, char *argv[] ) {
 
     // command-line arguments specify which objects to texture-map
     for( int i = 1; i < argc; ++i ) {
+
+        // options are spelled out
+        if( argv[i][0] == '-' ) {
+            if( strcmp(argv[i], "--layouts") == 0 ) {
+                benchLayout = true;
+            } else if( strcmp(argv[i], "--transforms") == 0 ) {
+                benchTransform = true;
+            } else if( strncmp(argv[i], "--profile=", 10) == 0 ) {
+                profilePath = argv[i] + 10;
+            } else if( strcmp(argv[i], "--bench") == 0 ) {
+                benchFrame = true;
+            } else if( strncmp(argv[i], "--frames=", 9) == 0 ) {
+                benchCount = atoi( argv[i] + 9 );
+                if( benchCount < 1 ) {
+                    cerr << "bad frame count '" << argv[i] + 9
+                         << "', using 500" << endl;
+                    benchCount = 500;
+                }
+            } else if( strcmp(argv[i], "--packed") == 0 ) {
+                vFormat = F_PACKED;
+            } else if( strcmp(argv[i], "--multidraw") == 0 ) {
+                multiDraw = true;
+            } else if( strcmp(argv[i], "--gldebug") == 0 ) {
+                glDebug = true;
+            } else if( strcmp(argv[i], "--uncompressed") == 0 ) {
+                compressTextures = false;
+            } else if( strcmp(argv[i], "--bilinear") == 0 ) {
+                // sample only the full-size level, as we used to
+                texSampler.minFilter = GL_LINEAR;
+            } else if( strncmp(argv[i], "--aniso=", 8) == 0 ) {
+                texSampler.anisotropy = atof( argv[i] + 8 );
+                if( texSampler.anisotropy < 1.0f ) {
+                    cerr << "bad anisotropy '" << argv[i] + 8
+                         << "', using 1" << endl;
+                    texSampler.anisotropy = 1.0f;
+                }
+            } else {
+                cerr << "bad option '" << argv[i] << "' ignored" << endl;
+            }
+            continue;
+        }
+
         switch( argv[i][0] ) {
         case 'c':
             mapAll = false;  map_obj[Cylinder] = true;
@@ -219,32 +343,66 @@ static void args( const int argc, char *argv[] ) {
 ///
 static void createImage(Canvas& C)
 {
+    PROFILE_SCOPE( "createImage" );
 
-    createObject(C, Cylinder,  buffers[Cylinder]);
-    createObject(C, Discs, buffers[Discs]);
-    createObject(C, Sphere,  buffers[Sphere]);
-    createObject(C, Sphere2, buffers[Sphere2]);
-    createObject(C, Sphere3, buffers[Sphere3]);
-    createObject(C, Cube, buffers[Cube]);
-    createObject(C, Cube2, buffers[Cube2]);
-    createObject(C, Cube3, buffers[Cube3]);
-    createObject(C, SemiSphere, buffers[SemiSphere]);
-    createObject(C, Prism,  buffers[Prism]);
-    createObject(C, Prism2, buffers[Prism2]);
-    createObject(C, Plate, buffers[Plate]);
-    createObject(C, Plateside, buffers[Plateside]);
-    createObject(C, Bread1, buffers[Bread1]);
-    createObject(C, Bread1a, buffers[Bread1a]);
-    createObject(C, Bread2, buffers[Bread2]);
-    createObject(C, Bread2a, buffers[Bread2a]);
-    createObject(C, Bread3, buffers[Bread3]);
-    createObject(C, Bread3a, buffers[Bread3a]);
-    createObject(C, Teapot, buffers[Teapot]);
-    createObject(C, Cylinder2, buffers[Cylinder2]);
-    createObject(C, Fork, buffers[Fork]);
-    createObject(C, Cylinder3, buffers[Cylinder3]);
-    createObject(C, Cylinder4, buffers[Cylinder4]);
+#if defined(DEBUG)
+    double start = glfwGetTime();
+#endif
+
+    // all the shapes go into one pool; objects which aren't
+    // texture mapped don't need their (u,v) data.  Objects built
+    // the same way share one copy of their mesh
+    pool.format = vFormat;
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        meshOwner[obj] = obj;
+        for( int o = 0; o < obj; ++o ) {
+            if( meshOwner[o] == o &&
+                meshObject( (Object) o ) == meshObject( (Object) obj ) &&
+                map_obj[o] == map_obj[obj] ) {
+                meshOwner[obj] = o;
+                break;
+            }
+        }
 
+        if( meshOwner[obj] == obj ) {
+            makeObject( C, (Object) obj );
+            pool.add( C, buffers[obj], map_obj[obj] );
+        } else {
+            pool.share( buffers[meshOwner[obj]], buffers[obj] );
+        }
+    }
+    pool.upload();
+
+#if defined(DEBUG)
+    cout << "createImage: " << (glfwGetTime() - start) * 1000.0
+         << " ms" << endl;
+
+    // report the effect of vertex welding on each object,
+    // along with the vertex and element buffer sizes
+    long before = 0, after = 0, vbytes = 0, ebytes = 0;
+    cout << "Vertex welding (before -> after), vertex buffer bytes,"
+         << " element buffer bytes" << endl;
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        BufferSet &b = buffers[obj];
+        if( meshOwner[obj] != obj ) {
+            cout << "  " << objects[obj] << ": shares "
+                 << objects[meshOwner[obj]] << endl;
+            continue;
+        }
+        long size = b.vSize + b.cSize + b.nSize + b.tSize;
+        cout << "  " << objects[obj] << ": " << b.numElements
+             << " -> " << b.numVerts << ", " << size << ", "
+             << b.eSize << endl;
+        before += b.numElements;
+        after += b.numVerts;
+        vbytes += size;
+        ebytes += b.eSize;
+    }
+    cout << "  total: " << before << " -> " << after << ", "
+         << vbytes << ", " << ebytes << endl;
+    cout << "  pool: stride " << pool.stride << ", index bytes "
+         << BufferSet::indexSize( pool.eType ) << endl;
+#endif
 }
 
 
@@ -253,41 +411,98 @@ static void createImage(Canvas& C)
 ///
 /// @param obj  the object being rotated
 ///
-static void rotate(int obj, float amt) {
-    angles[obj] += amt;
-    if (angles[obj] >= 360.0f) {
-        angles[obj] = 0.0f;
+static void rotate(Object obj, float amt) {
+    simCur.angles[obj] += amt;
+    if (simCur.angles[obj] >= 360.0f) {
+        simCur.angles[obj] -= 360.0f;
     }
 }
 ///
-/// Animation routine
+/// Is anything being animated?
+///
+/// @return true if animate() has work to do, else false
+///
+static bool animationActive(void) {
+    return animating[Teapot] || animating[Cylinder] || animateLight;
+}
+
+///
+/// Animation routine: advance the simulation by one SIM_STEP
 ///
 static void animate(void) {
 
+    simPrev = simCur;
+
     if (animating[Teapot]) {
         rotate(Teapot, 2.0f);
-        updateDisplay = true;
     }
 
     if (animating[Cylinder]) {
         rotate(Cylinder, 1.0f);
         rotate(Discs, 1.0f);
-        updateDisplay = true;
     }
 
     if (animateLight) {
-        if ((delta > 0.0f && lightpos.x >= lightMax) ||
-            (delta < 0.0f && lightpos.x <= lightMin)) {
+        if ((delta > 0.0f && simCur.lightX >= lightMax) ||
+            (delta < 0.0f && simCur.lightX <= lightMin)) {
             delta *= -1.0f;
         }
-        lightpos.x += delta;
-        updateDisplay = true;
+        simCur.lightX += delta;
     }
 }
+
+///
+/// Show the animation state part of the way from the previous
+/// simulation step to the current one
+///
+/// @param alpha  how far along (0 to 1)
+///
+static void showAnimation(float alpha) {
+
+    for (int i = 0; i < N_OBJECTS; ++i) {
+        float from = simPrev.angles[i], to = simCur.angles[i];
+        // go forward across the wrap at 360 degrees
+        if (to < from) {
+            to += 360.0f;
+        }
+        float angle = from + (to - from) * alpha;
+        if (angle >= 360.0f) {
+            angle -= 360.0f;
+        }
+        setObjectAngle((Object) i, angle);
+    }
+
+    lightpos.x = simPrev.lightX + (simCur.lightX - simPrev.lightX) * alpha;
+
+    updateDisplay = true;
+}
+
+///
+/// Bring the simulation state into line with the scene after it has
+/// been changed directly (e.g., by a reset)
+///
+static void syncAnimation(void) {
+
+    for (int i = 0; i < N_OBJECTS; ++i) {
+        simCur.angles[i] = objectAngle((Object) i);
+    }
+    simCur.lightX = lightpos.x;
+    simPrev = simCur;
+}
 //
 // Event callback routines for this assignment
 //
 
+///
+/// Handle window refresh requests (e.g., after the window is uncovered)
+///
+/// @param window   GLFW window being used
+///
+static void refresh(GLFWwindow* window)
+{
+    updateDisplay = true;
+}
+
 ///
 /// Handle keyboard input
 ///
@@ -368,8 +583,8 @@ static void keyboard(GLFWwindow* window, int key, int scan,
         // print out potentially useful information
 
     case GLFW_KEY_R: // rotation angles
-        cerr << "Rotation: quad " << angles[Teapot]
-            << ", cyl/disc " << angles[Cylinder] << endl;
+        cerr << "Rotation: quad " << objectAngle(Teapot)
+            << ", cyl/disc " << objectAngle(Cylinder) << endl;
         break;
 
     case GLFW_KEY_P: // light position
@@ -380,7 +595,10 @@ static void keyboard(GLFWwindow* window, int key, int scan,
         // Reset parameters
 
     case GLFW_KEY_1: // reset all object rotations
-        angles[Teapot] = angles[Cylinder] = angles[Discs] = 0.0f;
+        setObjectAngle(Teapot, 0.0f);
+        setObjectAngle(Cylinder, 0.0f);
+        setObjectAngle(Discs, 0.0f);
+        syncAnimation();
         break;
 
     case GLFW_KEY_2: // reset light position
@@ -388,6 +606,7 @@ static void keyboard(GLFWwindow* window, int key, int scan,
         lightpos[1] = lpDefault[1];
         lightpos[2] = lpDefault[2];
         lightpos[3] = lpDefault[3];
+        syncAnimation();
         break;
 
         // help message
@@ -438,156 +657,401 @@ void setTitle( void ) {
 }
 
 
+///
+/// Render queue ordering
+///
+/// @param a   a batch
+/// @param b   another batch
+///
+/// @return true if batch 'a' should be drawn before batch 'b'
+///
+static bool queueOrder( int a, int b )
+{
+    return( batchKey[a] < batchKey[b] );
+}
+
+///
+/// Group the objects into batches for drawing
+///
+/// Objects which share a mesh, shader program, and texture array are
+/// drawn together with one instanced draw (each instance choosing its
+/// own layer); everything else is drawn alone.
+///
+static void makeBatches( void )
+{
+    bool placed[N_OBJECTS] = { false };
+    int n = 0;
+
+    numBatches = 0;
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        if( placed[obj] ) {
+            continue;
+        }
+
+        glm::vec4 ambient, diffuse;
+        GLfloat exp;
+        GLint unit = getMaterial( (Object) obj, ambient, diffuse, exp );
+
+        batchFirst[numBatches] = n;
+        batchObjs[n++] = (Object) obj;
+        placed[obj] = true;
+
+        for( int o = obj + 1; instancing && o < N_OBJECTS &&
+             n - batchFirst[numBatches] < MAX_INSTANCES; ++o ) {
+            if( placed[o] || meshOwner[o] != meshOwner[obj] ||
+                getMaterial( (Object) o, ambient, diffuse, exp ) != unit ) {
+                continue;
+            }
+            batchObjs[n++] = (Object) o;
+            placed[o] = true;
+        }
+
+        batchSize[numBatches] = n - batchFirst[numBatches];
+        batchUnit[numBatches] = unit;
+
+        // sort key: program, texture array's unit (+1, so that it
+        // isn't negative), then mesh
+        batchKey[numBatches] = ((textured[obj] ? 1L : 0L) << 16) |
+                               ((long) (unit + 1) << 8) | meshOwner[obj];
+        renderQueue[numBatches] = numBatches;
+        ++numBatches;
+    }
+
+    stable_sort( renderQueue, renderQueue + numBatches, queueOrder );
+
+#if defined(DEBUG)
+    cout << "Drawing " << N_OBJECTS << " objects with " << numBatches
+         << " draw calls" << endl;
+#endif
+}
+
 ///
 /// Display the current image
 ///
 static void display( void )
 {
+    GPU_SCOPE( "display" );
+    DEBUG_GROUP( "display" );
+
+#if defined(DEBUG)
+    // CPU time spent issuing the frame, averaged over 100 frames
+    static double cpuTotal = 0.0;
+    static int cpuFrames = 0;
+    double cpuStart = glfwGetTime();
+#endif
+
+    renderStats = RenderStats();
+
     // clear the frame buffer
     glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
     // set our titlebar
     setTitle();
 
-    // check for any errors to this point
-    checkErrors( "display init" );
+    // every shape's data is in the pool
+    pool.bind();
 
-    // draw the individual objects
-    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+    // the camera, projection, and lighting are shared by all programs
+    if( frameBlock ) {
+        updateFrameData();
+    }
 
-        // select the proper shader program
-        GLuint program;
-        if (obj == Cylinder || obj == Cylinder3 || obj == Cylinder4 ||obj == Discs||obj==Cube2||obj==Cube||obj==Cube3||obj==SemiSphere|| obj == Cylinder2||obj==Plate || obj == Plateside ||obj==Bread1a || obj == Bread2a || obj == Bread3a||obj == Bread1 || obj == Bread2 || obj == Bread3){
-            program = texture;
+    // check for any errors to this point
+    CHECK_ERRORS( "display init" );
+
+    // draw the objects, one batch at a time, in render queue order
+    GLuint curProgram = 0;
+    GLint curUnit = -1;
+
+    for( int q = 0; q < numBatches; ++q ) {
+        int b = renderQueue[q];
+        const Object *objs = batchObjs + batchFirst[b];
+        int n = batchSize[b];
+
+        GPU_SCOPE( objects[objs[0]] );
+        DEBUG_GROUP( objects[objs[0]] );
+
+        // select the proper shader program; without the per-frame
+        // buffer, its data must be sent whenever the program changes
+        GLuint program = textured[objs[0]] ? texture : phong;
+        if( program != curProgram ) {
+            glUseProgram( program );
+            ++renderStats.programs;
+            curProgram = program;
+            curUnit = -1;
+
+            if( !frameBlock ) {
+                // set up the common transformations
+                setCamera( program );
+                setProjection( program );
+                CHECK_ERRORS( "display camera" );
+
+                // and our lighting
+                setLighting( program );
+            }
+            setMaterialConstants( program );
+            CHECK_ERRORS( "display lighting" );
         }
-        else {
-            program = phong;
+
+        // select the texture array when it changes
+        if( batchUnit[b] >= 0 && batchUnit[b] != curUnit ) {
+            setMaterialTexture( program, objs[0] );
+            curUnit = batchUnit[b];
         }
-        glUseProgram(program);
-
-        // set up the common transformations
-        setCamera( program );
-        setProjection( program );
-        checkErrors( "display camera" );
-
-        // and our lighting
-        setLighting( program );
-        checkErrors( "display lighting" );
-
-        // set texture parameters OR material properties
-        setMaterials( program, (Object) obj, map_obj[obj] );
-        checkErrors( "display materials" );
-
-        // select the correct rotation angles
-        glm::vec3 ang( angles[obj], angles[obj], angles[obj] );
-        glm::vec3 ang1(angles[obj], 80, angles[obj]);
-        glm::vec3 ang2(angles[obj], 220, angles[obj]);
-        glm::vec3 ang3(angles[obj], 45, angles[obj]);
-        glm::vec3 ang4(angles[obj], 30, angles[obj]);
-        glm::vec3 ang5(angles[obj], 30, angles[obj]);
-        glm::vec3 ang6(angles[obj], 30, angles[obj]);
-        glm::vec3 ang7(angles[obj], 220, angles[obj]);
-        glm::vec3 ang8(angles[obj], 220, angles[obj]);
-        glm::vec3 ang9(angles[obj], 100, angles[obj]);
-        glm::vec3 ang10(angles[obj], 80, angles[obj]);
-        glm::vec3 ang11(angles[obj], 220, angles[obj]);
-        glm::vec3 ang12(angles[obj], 220, angles[obj]);
-        glm::vec3 ang13(angles[obj], 100, angles[obj]);
-        glm::vec3 ang14(angles[obj], 220, angles[obj]);
-        glm::vec3 ang15(280, angles[obj], 110);
-        glm::vec3 ang16(270, 0, 60);
-        glm::vec3 ang17(0, 160, 00);
+
+        // per-instance material properties
+        setInstanceMaterials( program, objs, n );
+        CHECK_ERRORS( "display materials" );
 
         // send all the transformation data
-        switch( obj ) {
-    
-        case Cylinder:  // FALL THROUGH
-        case Discs:
-            setTransforms( program, cyl_s, ang, cyl_x );
-            break;
-        case Sphere:
-            
-            setTransforms(program, sph_s, ang5, sph_x);
-            break;
-        case Sphere2:
-            
-            setTransforms(program, sph2_s, ang3, sph2_x);
-            break;
-        case Sphere3:
-            
-            setTransforms(program, sph3_s, ang4, sph3_x);
-            break;
-        case Cube:
-            setTransforms(program, cube_s, ang, cube_x);
-            break;
-        case Cube2:
-            setTransforms(program, cube2_s, ang, cube2_x);
-            break;
-        case Cube3:
-            setTransforms(program, cube3_s, ang, cube3_x);
-            break;
-        case SemiSphere:
-            setTransforms(program, semisph_s, ang, semisph_x);
-            break;
-        case Prism:
-            setTransforms(program, prism_s, ang10, prism_x);
-            break;
-        case Prism2:
-            setTransforms(program, prism2_s, ang1, prism2_x);
-            break;
-        case Plate:
-            setTransforms(program, plate_s, ang2, plate_x);
-            break;
-        case Plateside:
-            setTransforms(program, plate2_s, ang14, plate2_x);
-            break;
-        case Bread1:
-            setTransforms(program, bread1_s, ang7, bread1_x);
-            break;
-        case Bread1a:
-            setTransforms(program, bread1a_s, ang11, bread1a_x);
-            break;
-        case Bread2:
-            setTransforms(program, bread2_s, ang8, bread2_x);
-            break;
-        case Bread2a:
-            setTransforms(program, bread2a_s, ang12, bread2a_x);
-            break;
-        case Bread3:
-            setTransforms(program, bread3_s, ang9, bread3_x);
-            break;
-        case Bread3a:
-            setTransforms(program, bread3a_s, ang13, bread3a_x);
-            break;
-        case Teapot:
-            setTransforms(program, teapot_s, ang6, teapot_x);
-            break;
-        case Cylinder2:
-            setTransforms(program, cyl2_s, ang, cyl2_x);
-            break;
-        case Fork:
-            setTransforms(program, fork_s, ang15, fork_x);
-            break;
-        case Cylinder3:
-            setTransforms(program, cyl3_s, ang16, cyl3_x);
-            break;
-        case Cylinder4:
-            setTransforms(program, cyl4_s, ang17, cyl4_x);
-            break;
+        glm::mat4 mats[MAX_INSTANCES];
+        for( int i = 0; i < n; ++i ) {
+            mats[i] = objectMatrix( objs[i] );
         }
-
-        checkErrors( "display xforms" );
+        setInstanceTransforms( program, mats, n );
+        CHECK_ERRORS( "display xforms" );
 
         // draw it
-        buffers[obj].selectBuffers( program,
-            "vPosition", NULL, "vNormal", 
-            map_obj[obj] ? "vTexCoord" : NULL );
-        checkErrors( "display select" );
+        buffers[objs[0]].draw( n );
+        ++renderStats.draws;
+        renderStats.triangles += (long) buffers[objs[0]].numElements / 3 * n;
+        CHECK_ERRORS( "display draw" );
+    }
+
+    glBindVertexArray( 0 );
+
+#if defined(DEBUG)
+    cpuTotal += glfwGetTime() - cpuStart;
+    if( ++cpuFrames == 100 ) {
+        cerr << "display: " << cpuTotal * 10.0 << " ms CPU/frame; "
+             << renderStats.programs << " program switches, "
+             << renderStats.textures << " texture changes, "
+             << renderStats.uniforms << " uniform uploads, "
+             << renderStats.draws << " draws" << endl;
+        cpuTotal = 0.0;
+        cpuFrames = 0;
+    }
+#endif
+}
+
+///
+/// Display the current image using one multi-draw call per program
+///
+static void displayMulti( void )
+{
+    GPU_SCOPE( "displayMulti" );
+    DEBUG_GROUP( "displayMulti" );
+
+#if defined(DEBUG)
+    // CPU time spent issuing the frame, averaged over 100 frames
+    static double cpuTotal = 0.0;
+    static int cpuFrames = 0;
+    double cpuStart = glfwGetTime();
+#endif
+
+    renderStats = RenderStats();
+
+    // clear the frame buffer
+    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+
+    // set our titlebar
+    setTitle();
 
-        glDrawElements( GL_TRIANGLES, buffers[obj].numElements,
-                        GL_UNSIGNED_INT, (void *) 0 );
-        checkErrors( "display draw" );
+    // every shape's data is in the pool
+    pool.bind();
+
+    // gather the per-object data (only the transformations change
+    // from frame to frame, but the whole block is tiny)
+    MDObject data[N_OBJECTS];
+    for( int i = 0; i < N_OBJECTS; ++i ) {
+        int obj = mdOrder[i];
+        glm::mat3 normal;
+
+        eyeTransforms( objectMatrix( (Object) obj ), data[i].modelViewMat,
+                       data[i].mvpMat, normal );
+        for( int c = 0; c < 3; ++c ) {
+            data[i].normalMat[c] = glm::vec4( normal[c], 0.0f );
+        }
+        getMaterial( (Object) obj, data[i].ambientColor,
+                     data[i].diffuseColor, data[i].specExp );
+        data[i].layer = getTextureLayer( (Object) obj );
     }
+    glBindBuffer( GL_UNIFORM_BUFFER, mdObjects );
+    glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(data), data );
+    ++renderStats.uniforms;
+
+    // the camera, projection, and lighting are shared by both programs
+    updateFrameData();
+    CHECK_ERRORS( "displayMulti objects" );
+
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, mdCommands );
+
+    int group = -1;
+    for( int d = 0; d < mdNumDraws; ++d ) {
+        const MDDraw &draw = mdDraws[d];
+
+        GPU_SCOPE( mdGroups[draw.group] );
+        DEBUG_GROUP( mdGroups[draw.group] );
+
+        GLuint program = mdPrograms[draw.group];
+        if( draw.group != group ) {
+            glUseProgram( program );
+            ++renderStats.programs;
+            group = draw.group;
+        }
+
+        // where this call's objects start, and their texture array
+        glUniform1i( uniformLoc( program, U_OBJECTBASE ), draw.first );
+        ++renderStats.uniforms;
+        if( draw.unit >= 0 ) {
+            glUniform1i( uniformLoc( program, U_TEXTURES ), draw.unit );
+            ++renderStats.uniforms;
+            ++renderStats.textures;
+        }
+
+        // draw all of these objects
+        glMultiDrawElementsIndirect( GL_TRIANGLES, pool.eType,
+            BUFFER_OFFSET(draw.first * sizeof(MDCommand)), draw.count, 0 );
+        ++renderStats.draws;
+        for( int i = draw.first; i < draw.first + draw.count; ++i ) {
+            renderStats.triangles += buffers[mdOrder[i]].numElements / 3;
+        }
+        CHECK_ERRORS( "displayMulti draw" );
+    }
+
+    glBindVertexArray( 0 );
+
+#if defined(DEBUG)
+    cpuTotal += glfwGetTime() - cpuStart;
+    if( ++cpuFrames == 100 ) {
+        cerr << "displayMulti: " << cpuTotal * 10.0 << " ms CPU/frame; "
+             << renderStats.programs << " program switches, "
+             << renderStats.uniforms << " uniform uploads, "
+             << renderStats.draws << " draws" << endl;
+        cpuTotal = 0.0;
+        cpuFrames = 0;
+    }
+#endif
+}
+
+///
+/// Set up for multi-draw rendering
+///
+/// @return true if multi-draw rendering can be used, else false
+///
+static bool initMultiDraw( void )
+{
+    // we need indirect draws, and the draw ID in the vertex shader
+    if( !(GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect) ||
+        !GLEW_ARB_shader_draw_parameters ) {
+        cerr << "Multi-draw rendering not supported, using one draw"
+             << " per object" << endl;
+        return( false );
+    }
+
+    if( N_OBJECTS > MD_MAX_OBJECTS ) {
+        cerr << "Too many objects for multi-draw rendering" << endl;
+        return( false );
+    }
+
+    // order the objects by program, then texture array, and build one
+    // command for each and one call for each run of commands which
+    // share both
+    MDCommand cmds[N_OBJECTS];
+    int n = 0;
+    mdNumDraws = 0;
+    for( int g = 0; g < 2; ++g ) {
+        for( GLint unit = -1; unit < numTextureArrays(); ++unit ) {
+            int first = n;
+            for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+                glm::vec4 ambient, diffuse;
+                GLfloat exp;
+                if( textured[obj] != (g == 0) ||
+                    getMaterial( (Object) obj, ambient, diffuse, exp )
+                        != unit ) {
+                    continue;
+                }
+                BufferSet &b = buffers[obj];
+                mdOrder[n] = obj;
+                cmds[n].count = b.numElements;
+                cmds[n].instanceCount = 1;
+                cmds[n].firstIndex = b.eOffset /
+                                     BufferSet::indexSize( b.eType );
+                cmds[n].baseVertex = b.baseVertex;
+                cmds[n].baseInstance = 0;
+                ++n;
+            }
+            if( n > first ) {
+                MDDraw draw = { g, unit, first, n - first };
+                mdDraws[mdNumDraws++] = draw;
+            }
+        }
+    }
+
+    // the shader programs; where each call's objects start, and which
+    // texture array it uses, are sent with the call
+    for( int g = 0; g < 2; ++g ) {
+        ShaderError error;
+        GLuint program = shaderSetup( mdShaders[g][0], mdShaders[g][1],
+                                      &error );
+        if( !program ) {
+            cerr << "Error setting up multi-draw shader " << mdShaders[g][0]
+                 << " - " << errorString(error) << endl;
+            return( false );
+        }
+        mdPrograms[g] = program;
+        labelObject( GL_PROGRAM, program, mdGroups[g] );
+
+        // the buffer must be at least as large as the shader's block
+        GLuint block = glGetUniformBlockIndex( program,
+                                               blockNames[B_OBJECTS] );
+        if( block != GL_INVALID_INDEX ) {
+            GLint size;
+            glGetActiveUniformBlockiv( program, block,
+                                       GL_UNIFORM_BLOCK_DATA_SIZE, &size );
+            if( size > (GLint) (MD_MAX_OBJECTS * sizeof(MDObject)) ) {
+                cerr << "Multi-draw shader " << mdShaders[g][0]
+                     << " has a " << size << "-byte Objects block; expected "
+                     << MD_MAX_OBJECTS * sizeof(MDObject) << endl;
+                return( false );
+            }
+        }
+
+        glUseProgram( program );
+        setMaterialConstants( program );
+    }
+    checkErrors( "initMultiDraw shaders" );
+
+    // the buffers
+    glGenBuffers( 1, &mdObjects );
+    glBindBuffer( GL_UNIFORM_BUFFER, mdObjects );
+    labelObject( GL_BUFFER, mdObjects, "Objects" );
+    glBufferData( GL_UNIFORM_BUFFER, MD_MAX_OBJECTS * sizeof(MDObject),
+                  NULL, GL_DYNAMIC_DRAW );
+    glBindBufferBase( GL_UNIFORM_BUFFER, B_OBJECTS, mdObjects );
+
+    glGenBuffers( 1, &mdCommands );
+    glBindBuffer( GL_DRAW_INDIRECT_BUFFER, mdCommands );
+    labelObject( GL_BUFFER, mdCommands, "draw commands" );
+    glBufferData( GL_DRAW_INDIRECT_BUFFER, sizeof(cmds), cmds,
+                  GL_STATIC_DRAW );
+    checkErrors( "initMultiDraw buffers" );
+
+    return( true );
+}
+
+///
+/// Report the time taken by a phase of the initialization
+///
+/// @param name   the phase
+/// @param mark   when it started; updated to the current time
+///
+static void startupPhase( const char *name, double &mark )
+{
+    double now = glfwGetTime();
+
+    startupTimes << " " << name << " " << (now - mark) * 1000.0 << " ms";
+    mark = now;
 }
 
 ///
@@ -597,6 +1061,8 @@ static void display( void )
 ///
 static bool init( void )
 {
+    PROFILE_SCOPE( "init" );
+
     // Check the OpenGL major version
     if( gl_maj < 3 || (gl_maj == 3 && gl_min < 2) ) {
         // select the other Phong shader
@@ -605,9 +1071,22 @@ static bool init( void )
         // warn about GLSL versions
         cerr << "Caution: GL version may not allow GLSL 1.50+"
              << " code to compile!" << endl;
+        instancing = false;
+        frameBlock = false;
+    }
+
+    // have errors reported as they happen, in place of the
+    // (release-build) per-draw glGetError() checks
+    if( glDebug ) {
+        initDebugOutput();
     }
     checkErrors( "init start" );
 
+    // the texture images are decoded in the background while the
+    // shaders are compiled and the geometry is built
+    double mark = glfwGetTime(), start = mark;
+    startTextureLoads( compressTextures, texSampler );
+
     // Load shaders and use the resulting shader program
     ShaderError error;
     phong = shaderSetup( vs_p, fs_p, &error );
@@ -616,6 +1095,7 @@ static bool init( void )
              << errorString(error) << endl;
         return( false );
     }
+    labelObject( GL_PROGRAM, phong, "phong" );
     checkErrors( "init shaders 1" );
 
     texture = shaderSetup( vs_t, fs_t, &error );
@@ -624,6 +1104,7 @@ static bool init( void )
              << errorString(error) << endl;
         return( false );
     }
+    labelObject( GL_PROGRAM, texture, "texture" );
     checkErrors( "init shaders 2" );
 
 #ifdef DEBUG
@@ -638,6 +1119,7 @@ static bool init( void )
     dumpActives( texture );
     checkErrors( "init actives" );
 #endif
+    startupPhase( "shaders", mark );
 
     // create our Canvas
     canvas = new Canvas( w_width, w_height );
@@ -646,12 +1128,6 @@ static bool init( void )
         return( false );
     }
 
-    // need a VAO if we're using a core context;
-    // doesn't hurt even if we're not using one
-    glGenVertexArrays( 1, &vao );
-    glBindVertexArray( vao );
-    checkErrors( "init vao" );
-
     // OpenGL state initialization
     glEnable( GL_DEPTH_TEST );
     glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
@@ -660,15 +1136,48 @@ static bool init( void )
     glClearDepth( 1.0f );
     checkErrors( "init setup" );
 
+    // the per-frame uniform buffer shared by the shader programs
+    if( frameBlock && !initFrameData() ) {
+        cerr << "Error - uniform buffers are not supported" << endl;
+        return( false );
+    }
+    checkErrors( "init frame data" );
+
     // create the geometry for our shapes.
     createImage( *canvas );
     checkErrors( "init image" );
 
+    // which shader program draws each object
+    for( int obj = 0; obj < N_OBJECTS; ++obj ) {
+        glm::vec4 ambient, diffuse;
+        GLfloat exp;
+        textured[obj] = getMaterial( (Object) obj, ambient, diffuse, exp ) >= 0;
+    }
+
+    // group the objects into batches
+    makeBatches();
+
+    if( multiDraw ) {
+        multiDraw = initMultiDraw();
+    }
+    startupPhase( "geometry", mark );
+
     // initialize all texture-related things
     initTextures();
     checkErrors( "init textures" );
-
-    
+    startupPhase( "textures", mark );
+    startupPhase( "total", start );
+
+    // report the phase times (always in DEBUG builds; otherwise, only
+    // when profiling)
+#if defined(DEBUG)
+    bool report = true;
+#else
+    bool report = profiling();
+#endif
+    if( report ) {
+        cerr << "startup:" << startupTimes.str() << endl;
+    }
 
     return( true );
 }
@@ -694,22 +1203,91 @@ void application( int argc, char *argv[] )
         }
     }
 
-    // set up the objects and the scene
+    if( profilePath != NULL ) {
+        profileInit( profilePath );
+    }
+
+    // set up the objects and the scene; the texture images may still
+    // be loading if it fails part way
     if( !init() ) {
+        cancelTextureLoads();
         return;
     }
 
     checkErrors( "after init" );
-    // loop until it's time to quit
+
+    // benchmarks replace the interactive session
+    if( benchLayout ) {
+        benchLayouts( *canvas, phong );
+        return;
+    }
+    if( benchTransform ) {
+        benchTransforms( *canvas );
+        return;
+    }
+    if( benchFrame ) {
+        benchFrames( multiDraw ? displayMulti : display, benchCount,
+                     w_width, w_height );
+        return;
+    }
+
+    glfwSetKeyCallback(w_window, keyboard);
+    glfwSetWindowRefreshCallback(w_window, refresh);
+
+    // frames are paced by the display while animating
+    glfwSwapInterval(1);
+
+    // loop until it's time to quit; the simulation runs in fixed steps
+    // driven by the clock, and each frame shows the state interpolated
+    // to the current time, so motion doesn't depend on the frame rate
+    syncAnimation();
+    double previous = glfwGetTime();
+    double lastFrame = previous;
+    double lag = 0.0;
     while (!glfwWindowShouldClose(w_window)) {
-        animate();
+        double now = glfwGetTime();
+        if (animationActive()) {
+            lag += now - previous;
+            if (lag > MAX_LAG) {
+                lag = MAX_LAG;
+            }
+            while (lag >= SIM_STEP) {
+                animate();
+                lag -= SIM_STEP;
+            }
+            showAnimation((float) (lag / SIM_STEP));
+        }
+        previous = now;
+
         if (updateDisplay) {
             updateDisplay = false;
-            display();
-            glfwSwapBuffers(w_window);
-            checkErrors("event loop");
+            lastFrame = now;
+            if( multiDraw ) {
+                displayMulti();
+            } else {
+                display();
+            }
+            {
+                PROFILE_SCOPE( "swap" );
+                glfwSwapBuffers(w_window);
+            }
+            profileFrame();
+            CHECK_ERRORS("event loop");
+        }
+        if (animationActive()) {
+            // handle input while waiting for the next frame to be due
+            double wait = lastFrame + MIN_FRAME - glfwGetTime();
+            if (wait > 0.0) {
+                glfwWaitEventsTimeout(wait);
+            } else {
+                glfwPollEvents();
+            }
+        } else {
+            // nothing moves until some input arrives
+            glfwWaitEvents();
+            previous = glfwGetTime();
+            lag = 0.0;
         }
-        glfwPollEvents();
     }
  
 }
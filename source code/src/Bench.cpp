@@ -0,0 +1,314 @@
+//
+//  Bench.cpp
+//
+//  Micro-benchmarks for the rendering framework.
+//
+//  These are run instead of the normal event loop when requested
+//  on the command line; each reports its results on stdout.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/vec3.hpp>
+
+#include "Bench.h"
+
+#include "Buffers.h"
+#include "FrameData.h"
+#include "Lighting.h"
+#include "Models.h"
+#include "Profile.h"
+#include "ShaderSetup.h"
+#include "Utils.h"
+#include "Viewing.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// number of untimed and timed draws per test
+static const int warmup = 20;
+static const int draws = 1000;
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Compare the vertex buffer layouts and formats
+///
+/// Draws the Cube20 and Sphere20 meshes repeatedly using blocked and
+/// interleaved floats and interleaved packed data, with rasterization
+/// disabled, so that the timings reflect vertex fetch and vertex
+/// shading rather than fragment work.
+///
+/// @param C        the Canvas to use when creating the meshes
+/// @param program  the shader program to draw with
+///
+void benchLayouts( Canvas &C, GLuint program )
+{
+    const Object meshes[] = { Cube, Sphere };
+    const Layout layouts[] = { L_BLOCKED, L_INTERLEAVED, L_INTERLEAVED };
+    const Format formats[] = { F_FLOAT, F_FLOAT, F_PACKED };
+    const char *names[] = { "blocked", "interleaved", "packed" };
+    const int nTests = sizeof(layouts) / sizeof(layouts[0]);
+
+    glUseProgram( program );
+    if( frameDataInUse() ) {
+        updateFrameData();
+    } else {
+        setCamera( program );
+        setProjection( program );
+        setLighting( program );
+    }
+    setTransforms( program, glm::vec3(1.0f), glm::vec3(0.0f),
+                   glm::vec3(0.0f) );
+
+    // only the vertex stage is of interest here
+    glEnable( GL_RASTERIZER_DISCARD );
+
+    cout << "Layout benchmark (" << draws << " draws per test)" << endl;
+    cout << setw(8) << "mesh" << setw(14) << "layout" << setw(10)
+         << "vertices" << setw(10) << "stride" << setw(12) << "us/draw"
+         << setw(12) << "Mverts/s" << endl;
+
+    for( int m = 0; m < 2; ++m ) {
+        for( int l = 0; l < nTests; ++l ) {
+            BufferSet buf;
+
+            buf.layout = layouts[l];
+            buf.format = formats[l];
+            createObject( C, meshes[m], buf );
+            buf.enableAttrib( A_TEXCOORD, false );
+            buf.bind();
+
+            for( int i = 0; i < warmup; ++i ) {
+                buf.draw();
+            }
+            glFinish();
+
+            double start = glfwGetTime();
+            for( int i = 0; i < draws; ++i ) {
+                buf.draw();
+            }
+            glFinish();
+            double elapsed = glfwGetTime() - start;
+
+            cout << setw(8) << objects[meshes[m]] << setw(14) << names[l]
+                 << setw(10) << buf.numVerts << setw(10) << buf.stride
+                 << setw(12) << fixed << setprecision(2)
+                 << elapsed * 1.0e6 / draws
+                 << setw(12) << (double) buf.numElements * draws
+                                / elapsed / 1.0e6
+                 << endl;
+
+            glDeleteBuffers( 1, &buf.vbuffer );
+            glDeleteBuffers( 1, &buf.ebuffer );
+            glBindVertexArray( 0 );
+            glDeleteVertexArrays( 1, &buf.vao );
+        }
+    }
+
+    glDisable( GL_RASTERIZER_DISCARD );
+    checkErrors( "benchLayouts" );
+}
+
+///
+/// Compare per-vertex and precomputed transformation matrices
+///
+/// Draws the Cube20 mesh repeatedly, with rasterization disabled, using
+/// the old Phong vertex shader (which builds the modelView matrix and
+/// inverts the normal matrix for every vertex) and the current one
+/// (which is given those matrices by the application).
+///
+/// @param C        the Canvas to use when creating the mesh
+///
+void benchTransforms( Canvas &C )
+{
+    const char *shaders[] = { "p150inv.vert", "p150.vert" };
+    const char *names[] = { "per-vertex", "precomputed" };
+
+    // both shaders take the camera and light from the frame data
+    if( !frameDataInUse() ) {
+        cerr << "Transformation benchmark needs GLSL 1.50" << endl;
+        return;
+    }
+    updateFrameData();
+
+    BufferSet buf;
+    createObject( C, Cube, buf );
+    buf.enableAttrib( A_TEXCOORD, false );
+
+    // only the vertex stage is of interest here
+    glEnable( GL_RASTERIZER_DISCARD );
+
+    cout << "Transformation benchmark (" << draws << " draws of "
+         << buf.numElements << " vertices per test)" << endl;
+    cout << setw(14) << "matrices" << setw(12) << "us/draw"
+         << setw(12) << "Mverts/s" << endl;
+
+    for( int s = 0; s < 2; ++s ) {
+        ShaderError error;
+        GLuint program = shaderSetup( shaders[s], "p150.frag", &error );
+        if( !program ) {
+            cerr << "Error setting up shader " << shaders[s] << " - "
+                 << errorString(error) << endl;
+            continue;
+        }
+
+        glUseProgram( program );
+        setTransforms( program, glm::vec3(1.0f), glm::vec3(0.0f),
+                       glm::vec3(0.0f) );
+        buf.bind();
+
+        for( int i = 0; i < warmup; ++i ) {
+            buf.draw();
+        }
+        glFinish();
+
+        double start = glfwGetTime();
+        for( int i = 0; i < draws; ++i ) {
+            buf.draw();
+        }
+        glFinish();
+        double elapsed = glfwGetTime() - start;
+
+        cout << setw(14) << names[s] << setw(12) << fixed
+             << setprecision(2) << elapsed * 1.0e6 / draws
+             << setw(12) << (double) buf.numElements * draws
+                            / elapsed / 1.0e6
+             << endl;
+
+        glUseProgram( 0 );
+        glDeleteProgram( program );
+    }
+
+    glDisable( GL_RASTERIZER_DISCARD );
+
+    glDeleteBuffers( 1, &buf.vbuffer );
+    glDeleteBuffers( 1, &buf.ebuffer );
+    glBindVertexArray( 0 );
+    glDeleteVertexArrays( 1, &buf.vao );
+    checkErrors( "benchTransforms" );
+}
+
+///
+/// Find a percentile of a sorted set of samples (nearest rank)
+///
+/// @param samples  the samples, in ascending order
+/// @param pct      the percentile (0 to 100)
+///
+/// @return the sample at that percentile
+///
+static double percentile( const vector<double> &samples, double pct )
+{
+    size_t rank = (size_t) ceil( pct / 100.0 * samples.size() );
+
+    return( samples[ rank > 0 ? rank - 1 : 0 ] );
+}
+
+///
+/// Measure whole-frame rendering times
+///
+/// Renders the scene 'frames' times into an offscreen framebuffer
+/// (after a few untimed frames), waiting for each to finish, and
+/// writes one line of JSON to stdout with the minimum, mean, median,
+/// 95th, and 99th percentile frame times (in milliseconds) and the
+/// triangle throughput.  Nothing is shown on screen, so this works
+/// with an invisible window or a surfaceless context.
+///
+/// @param draw     the function which draws one frame
+/// @param frames   how many frames to time
+/// @param width    width of the framebuffer
+/// @param height   height of the framebuffer
+///
+void benchFrames( void (*draw)( void ), int frames, int width, int height )
+{
+    // the offscreen framebuffer
+    GLuint fbo, rbuf[2];
+
+    glGenFramebuffers( 1, &fbo );
+    glBindFramebuffer( GL_FRAMEBUFFER, fbo );
+    glGenRenderbuffers( 2, rbuf );
+
+    glBindRenderbuffer( GL_RENDERBUFFER, rbuf[0] );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, width, height );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_RENDERBUFFER, rbuf[0] );
+
+    glBindRenderbuffer( GL_RENDERBUFFER, rbuf[1] );
+    glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+                           width, height );
+    glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                               GL_RENDERBUFFER, rbuf[1] );
+
+    GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+    if( status != GL_FRAMEBUFFER_COMPLETE ) {
+        cerr << "*** benchFrames: framebuffer incomplete (0x" << hex
+             << status << dec << ")" << endl;
+    } else {
+        glViewport( 0, 0, width, height );
+
+        for( int i = 0; i < warmup; ++i ) {
+            draw();
+        }
+        glFinish();
+
+        // time each frame through to completion
+        vector<double> times( frames );
+        double total = 0.0;
+        for( int i = 0; i < frames; ++i ) {
+            double start = glfwGetTime();
+            draw();
+            glFinish();
+            times[i] = (glfwGetTime() - start) * 1000.0;
+            profileFrame();
+            total += times[i];
+        }
+        long triangles = renderStats.triangles;
+
+        sort( times.begin(), times.end() );
+
+        const char *renderer = (const char *) glGetString( GL_RENDERER );
+        string name( renderer ? renderer : "unknown" );
+        for( size_t i = 0; i < name.size(); ++i ) {
+            if( name[i] == '"' || name[i] == '\\' ) {
+                name[i] = '_';
+            }
+        }
+
+        cout << fixed << setprecision(3)
+             << "{\"renderer\": \"" << name << "\""
+             << ", \"width\": " << width
+             << ", \"height\": " << height
+             << ", \"frames\": " << frames
+             << ", \"min_ms\": " << times[0]
+             << ", \"mean_ms\": " << total / frames
+             << ", \"p50_ms\": " << percentile( times, 50.0 )
+             << ", \"p95_ms\": " << percentile( times, 95.0 )
+             << ", \"p99_ms\": " << percentile( times, 99.0 )
+             << ", \"triangles_per_frame\": " << triangles
+             << ", \"triangles_per_sec\": " << setprecision(0)
+             << triangles * frames / (total / 1000.0)
+             << "}" << endl;
+    }
+
+    glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+    glDeleteRenderbuffers( 2, rbuf );
+    glDeleteFramebuffers( 1, &fbo );
+    checkErrors( "benchFrames" );
+}
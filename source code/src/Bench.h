@@ -0,0 +1,64 @@
+//
+//  Bench.h
+//
+//  Micro-benchmarks for the rendering framework.
+//
+//  These are run instead of the normal event loop when requested
+//  on the command line; each reports its results on stdout.
+//
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Canvas.h"
+
+///
+/// Compare the vertex buffer layouts and formats
+///
+/// Draws the Cube20 and Sphere20 meshes repeatedly using blocked and
+/// interleaved floats and interleaved packed data, with rasterization
+/// disabled, so that the timings reflect vertex fetch and vertex
+/// shading rather than fragment work.
+///
+/// @param C        the Canvas to use when creating the meshes
+/// @param program  the shader program to draw with
+///
+void benchLayouts( Canvas &C, GLuint program );
+
+///
+/// Compare per-vertex and precomputed transformation matrices
+///
+/// Draws the Cube20 mesh repeatedly, with rasterization disabled, using
+/// the old Phong vertex shader (which builds the modelView matrix and
+/// inverts the normal matrix for every vertex) and the current one
+/// (which is given those matrices by the application).
+///
+/// @param C        the Canvas to use when creating the mesh
+///
+void benchTransforms( Canvas &C );
+
+///
+/// Measure whole-frame rendering times
+///
+/// Renders the scene 'frames' times into an offscreen framebuffer
+/// (after a few untimed frames), waiting for each to finish, and
+/// writes one line of JSON to stdout with the minimum, mean, median,
+/// 95th, and 99th percentile frame times (in milliseconds) and the
+/// triangle throughput.  Nothing is shown on screen, so this works
+/// with an invisible window or a surfaceless context.
+///
+/// @param draw     the function which draws one frame
+/// @param frames   how many frames to time
+/// @param width    width of the framebuffer
+/// @param height   height of the framebuffer
+///
+void benchFrames( void (*draw)( void ), int frames, int width, int height );
+
+#endif
@@ -10,7 +10,10 @@
 //  This file should not be modified by students.
 //
 
+#include <cmath>
 #include <cstdlib>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -26,10 +29,333 @@
 #include "Buffers.h"
 #include "Utils.h"
 
+//
+// Vertex data encoders
+//
+// Each copies one vertex's worth of one kind of data from the Canvas
+// into the vertex buffer, converting it to the selected format.
+//
+
+///
+/// floatToHalf(f) - convert a float to an IEEE half-precision value
+///
+/// Values too large for a half are clamped to the largest finite one.
+///
+/// @param f   the value to convert
+/// @return    the half-precision bit pattern
+///
+static GLushort floatToHalf( float f ) {
+    GLuint bits;
+    memcpy( &bits, &f, sizeof(bits) );
+
+    GLuint sign = (bits >> 16) & 0x8000;
+    int exp = (int) ((bits >> 23) & 0xff) - 127 + 15;
+    GLuint mant = bits & 0x7fffff;
+
+    if( exp >= 31 ) {
+        // too big (or Inf/NaN); clamp to the largest finite half
+        return (GLushort) (sign | 0x7bff);
+    }
+
+    if( exp <= 0 ) {
+        // subnormal half, or too small and flushed to zero; also
+        // rounded to nearest even (rounding up from the largest
+        // subnormal correctly gives the smallest normal)
+        if( exp < -10 ) {
+            return (GLushort) sign;
+        }
+        int shift = 14 - exp;
+        GLuint full = mant | 0x800000;
+        GLuint h = full >> shift;
+        GLuint rest = full & ((1u << shift) - 1);
+        GLuint halfway = 1u << (shift - 1);
+        if( rest > halfway || (rest == halfway && (h & 1)) ) {
+            ++h;
+        }
+        return (GLushort) (sign | h);
+    }
+
+    // normal half, rounded to nearest even (a carry out of the
+    // mantissa correctly bumps the exponent)
+    GLuint h = sign | ((GLuint) exp << 10) | (mant >> 13);
+    GLuint rest = mant & 0x1fff;
+    if( rest > 0x1000 || (rest == 0x1000 && (h & 1)) ) {
+        ++h;
+        if( (h & 0x7fff) >= 0x7c00 ) {
+            h = sign | 0x7bff;
+        }
+    }
+    return (GLushort) h;
+}
+
+///
+/// packNormal(n) - pack a normal into GL_INT_2_10_10_10_REV form
+///
+/// The normal is made unit length first so that it fits the signed
+/// normalized range; the shaders only use its direction.
+///
+/// @param n   XYZ of the normal
+/// @return    the packed value (W is 0)
+///
+static GLuint packNormal( const float *n ) {
+    float len = sqrtf( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+    float scale = len > 0.0f ? 511.0f / len : 0.0f;
+    GLuint packed = 0;
+
+    for( int i = 0; i < 3; ++i ) {
+        int v = (int) lrintf( n[i] * scale );
+        v = v < -511 ? -511 : (v > 511 ? 511 : v);
+        packed |= ((GLuint) v & 0x3ff) << (10 * i);
+    }
+
+    return packed;
+}
+
+static void putPosition( char *dst, const float *src, Format f ) {
+    memcpy( dst, src, (f == F_PACKED ? 3 : 4) * sizeof(float) );
+}
+
+static void putColor( char *dst, const float *src, Format f ) {
+    if( f == F_PACKED ) {
+        for( int i = 0; i < 4; ++i ) {
+            float c = src[i] < 0.0f ? 0.0f : (src[i] > 1.0f ? 1.0f : src[i]);
+            dst[i] = (char) (GLubyte) lrintf( c * 255.0f );
+        }
+    } else {
+        memcpy( dst, src, 4 * sizeof(float) );
+    }
+}
+
+static void putNormal( char *dst, const float *src, Format f ) {
+    if( f == F_PACKED ) {
+        GLuint packed = packNormal( src );
+        memcpy( dst, &packed, sizeof(packed) );
+    } else {
+        memcpy( dst, src, 3 * sizeof(float) );
+    }
+}
+
+static void putUV( char *dst, const float *src, Format f ) {
+    if( f == F_PACKED ) {
+        GLushort half[2] = { floatToHalf(src[0]), floatToHalf(src[1]) };
+        memcpy( dst, half, sizeof(half) );
+    } else {
+        memcpy( dst, src, 2 * sizeof(float) );
+    }
+}
+
+///
+/// writeVertices() - encode vertex data into a mapped vertex buffer
+///
+/// Data which is NULL is skipped; 'size' and 'step' give the per-vertex
+/// size of each type of data in the buffer and the distance from one
+/// vertex's data to the next, in the order location, color, normal,
+/// (u,v).
+///
+/// @param dst      where the first vertex's data starts
+/// @param n        number of vertices
+/// @param p        XYZW locations
+/// @param c        RGBA colors (or NULL)
+/// @param nv       XYZ normals (or NULL)
+/// @param t        UV coordinates (or NULL)
+/// @param f        data format to write
+/// @param offset   offsets of the four types of data from 'dst'
+/// @param step     strides of the four types of data
+///
+static void writeVertices( char *dst, int n, const float *p, const float *c,
+        const float *nv, const float *t, Format f,
+        const long offset[4], const long step[4] ) {
+
+    for( int i = 0; i < n; ++i ) {
+        putPosition( dst + offset[0] + i * step[0], p + i * 4, f );
+        if( c != NULL ) {
+            putColor( dst + offset[1] + i * step[1], c + i * 4, f );
+        }
+        if( nv != NULL ) {
+            putNormal( dst + offset[2] + i * step[2], nv + i * 3, f );
+        }
+        if( t != NULL ) {
+            putUV( dst + offset[3] + i * step[3], t + i * 2, f );
+        }
+    }
+}
+
+///
+/// writeElements() - narrow element data into the bound element buffer
+///
+/// @param src    the element data
+/// @param n      number of elements
+/// @param type   the element type in the buffer
+/// @param size   size of the buffer (bytes)
+///
+/// @return true on success, else false
+///
+static bool writeElements( const GLuint *src, int n, GLenum type,
+        long size ) {
+
+    if( type == GL_UNSIGNED_INT ) {
+        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER, 0, size, src );
+        return( true );
+    }
+
+    void *dst = glMapBufferRange( GL_ELEMENT_ARRAY_BUFFER, 0, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+    if( dst == NULL ) {
+        cerr << "*** can't map element buffer" << endl;
+        return( false );
+    }
+
+    if( type == GL_UNSIGNED_SHORT ) {
+        GLushort *e = (GLushort *) dst;
+        for( int i = 0; i < n; ++i ) {
+            e[i] = (GLushort) src[i];
+        }
+    } else {
+        GLubyte *e = (GLubyte *) dst;
+        for( int i = 0; i < n; ++i ) {
+            e[i] = (GLubyte) src[i];
+        }
+    }
+
+    glUnmapBuffer( GL_ELEMENT_ARRAY_BUFFER );
+    return( true );
+}
+
+///
+/// smallestIndex(n) - the smallest element type which can address
+///     'n' vertices
+///
+/// @param n   number of vertices
+///
+/// @return GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT
+///
+static GLenum smallestIndex( int n ) {
+    if( n <= 256 ) {
+        return( GL_UNSIGNED_BYTE );
+    } else if( n <= 65536 ) {
+        return( GL_UNSIGNED_SHORT );
+    }
+    return( GL_UNSIGNED_INT );
+}
+
+///
+/// recordAttribs() - record the attribute setup in the bound vertex array
+///
+/// Every shader program has its attributes at the same fixed locations
+/// (see shaderLink()), so this is done once rather than per draw.
+///
+/// @param f        data format
+/// @param stride   distance between vertices (0 if tightly packed)
+/// @param offset   offsets of the location, color, normal, and (u,v)
+///                 data, or -1 for data which isn't present
+///
+static void recordAttribs( Format f, GLsizei stride, const long offset[4] ) {
+    bool packed = f == F_PACKED;
+
+    glEnableVertexAttribArray( A_POSITION );
+    glVertexAttribPointer( A_POSITION, packed ? 3 : 4, GL_FLOAT, GL_FALSE,
+                           stride, BUFFER_OFFSET(offset[0]) );
+
+    if( offset[1] >= 0 ) {
+        glEnableVertexAttribArray( A_COLOR );
+        if( packed ) {
+            glVertexAttribPointer( A_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                                   stride, BUFFER_OFFSET(offset[1]) );
+        } else {
+            glVertexAttribPointer( A_COLOR, 4, GL_FLOAT, GL_FALSE, stride,
+                                   BUFFER_OFFSET(offset[1]) );
+        }
+    }
+
+    if( offset[2] >= 0 ) {
+        glEnableVertexAttribArray( A_NORMAL );
+        if( packed ) {
+            glVertexAttribPointer( A_NORMAL, 4, GL_INT_2_10_10_10_REV,
+                                   GL_TRUE, stride, BUFFER_OFFSET(offset[2]) );
+        } else {
+            glVertexAttribPointer( A_NORMAL, 3, GL_FLOAT, GL_FALSE, stride,
+                                   BUFFER_OFFSET(offset[2]) );
+        }
+    }
+
+    if( offset[3] >= 0 ) {
+        glEnableVertexAttribArray( A_TEXCOORD );
+        glVertexAttribPointer( A_TEXCOORD, 2, packed ? GL_HALF_FLOAT : GL_FLOAT,
+                               GL_FALSE, stride, BUFFER_OFFSET(offset[3]) );
+    }
+}
+
+///
+/// checkFormat(f) - fall back to floats if packed data isn't supported
+///
+/// @param f   the requested format
+///
+/// @return the format to use
+///
+static Format checkFormat( Format f ) {
+    // packed normals need GL 3.3 (or the equivalent extension)
+    if( f == F_PACKED &&
+        !(GLEW_VERSION_3_3 || GLEW_ARB_vertex_type_2_10_10_10_rev) ) {
+        static bool warned = false;
+        if( !warned ) {
+            cerr << "createBuffers: packed vertices not supported,"
+                 << " using floats" << endl;
+            warned = true;
+        }
+        return( F_FLOAT );
+    }
+    return( f );
+}
+
+///
+/// discardBuffers(vao,vbuffer,ebuffer) - delete objects made for a
+///     buffer upload which failed part way
+///
+/// Any of them may not have been created yet (zero).  The vertex array
+/// is unbound first.
+///
+/// @param vao       the vertex array
+/// @param vbuffer   the vertex buffer
+/// @param ebuffer   the element buffer
+///
+static void discardBuffers( GLuint &vao, GLuint &vbuffer, GLuint &ebuffer ) {
+    glBindVertexArray( 0 );
+    glDeleteBuffers( 1, &vbuffer );
+    glDeleteBuffers( 1, &ebuffer );
+    glDeleteVertexArrays( 1, &vao );
+    vao = vbuffer = ebuffer = 0;
+}
+
+///
+/// releaseBuffers(buf) - reset a BufferSet which may already be in use
+///
+/// Its buffers are deleted first, unless they belong to a BufferPool.
+///
+/// @param buf   the BufferSet
+///
+static void releaseBuffers( BufferSet &buf ) {
+    if( !buf.bufferInit ) {
+        return;
+    }
+
+    if( !buf.pooled ) {
+        glDeleteBuffers( 1, &(buf.vbuffer) );
+        glDeleteBuffers( 1, &(buf.ebuffer) );
+        glDeleteVertexArrays( 1, &(buf.vao) );
+    }
+
+    // clear everything out
+    buf.initBuffer();
+}
+
 ///
 /// Constructor
 ///
 BufferSet::BufferSet( void ) {
+    // interleaved floats unless the application asks otherwise
+    layout = L_INTERLEAVED;
+    format = F_FLOAT;
+
     // do this the easy way
     initBuffer();
 }
@@ -38,9 +364,15 @@ BufferSet::BufferSet( void ) {
 /// initBuffer() - reset the BufferSet to its "empty" state
 ///
 void BufferSet::initBuffer( void ) {
-    vbuffer = ebuffer = 0;
-    numElements = 0;
+    vao = vbuffer = ebuffer = 0;
+    numElements = numVerts = 0;
+    baseVertex = 0;
+    eOffset = 0;
+    pooled = false;
+    eType = GL_UNSIGNED_INT;
     vSize = eSize = tSize = cSize = nSize = 0;
+    vOffset = cOffset = nOffset = tOffset = 0;
+    stride = 0;
     bufferInit = false;
 }
 
@@ -56,9 +388,15 @@ void BufferSet::dumpBuffer( const char *which ) {
     }
     cout << "initialized)" << endl;
     cout << "  IDs: v " << vbuffer << " e " << ebuffer <<
-        " #elements: " << numElements << endl;
+        " #elements: " << numElements << " #vertices: " << numVerts <<
+        " index bytes: " << indexSize( eType ) << endl;
     cout << "  Sizes:  v " << vSize << " e " << eSize <<
         " t " << tSize << " c " << cSize << " n " << nSize << endl;
+    cout << "  Layout: " <<
+        (layout == L_INTERLEAVED ? "interleaved" : "blocked") <<
+        (format == F_PACKED ? " packed" : " float") <<
+        " stride " << stride << " offsets: v " << vOffset << " c " <<
+        cOffset << " n " << nOffset << " t " << tOffset << endl;
 }
 
 ///
@@ -80,6 +418,21 @@ GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size ) {
     return( buffer );
 }
 
+///
+/// indexSize(type) - size of one element of an element array
+///
+/// @param type   GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT
+///
+/// @return the size in bytes
+///
+int BufferSet::indexSize( GLenum type ) {
+    switch( type ) {
+    case GL_UNSIGNED_BYTE:   return sizeof(GLubyte);
+    case GL_UNSIGNED_SHORT:  return sizeof(GLushort);
+    default:                 return sizeof(GLuint);
+    }
+}
+
 ///
 /// createBuffers(canvas) create a set of buffers for the object
 ///     currently held in 'canvas'.
@@ -89,13 +442,7 @@ GLuint BufferSet::makeBuffer( GLenum target, const void *data, GLsizei size ) {
 void BufferSet::createBuffers( Canvas &C ) {
 
     // reset this BufferSet if it has already been used
-    if( bufferInit ) {
-        // must delete the existing buffer IDs first
-        glDeleteBuffers( 1, &(vbuffer) );
-        glDeleteBuffers( 1, &(ebuffer) );
-        // clear everything out
-        initBuffer();
-    }
+    releaseBuffers( *this );
 
     //
     // vertex buffer structure
@@ -104,184 +451,429 @@ void BufferSet::createBuffers( Canvas &C ) {
     // other fields may or may not be present; this depends on
     // how the shape was created
     //
+    // with the blocked layout, each type of data occupies its own
+    // section of the buffer:
+    //
     //             data        components   offset to beginning
     //          [ locations ]  XYZW         0
     //          [ colors    ]  RGBA         vSize
     //          [ normals   ]  XYZ          vSize+cSize
     //          [ t. coords ]  UV           vSize+cSize+nSize
     //
+    // with the interleaved layout, all the data for a vertex is
+    // stored together, and the stride is the size of one vertex:
+    //
+    //          [ XYZW RGBA XYZ UV ] [ XYZW RGBA XYZ UV ] ...
+    //
+    // with the packed format, locations lose their W (always 1.0),
+    // colors are RGBA8, normals are GL_INT_2_10_10_10_REV, and (u,v)
+    // pairs are half floats, cutting each vertex from 52 to 24 bytes
+    //
 
-    // get the vertex count
-    numElements = C.numVertices();
+    // get the element and (welded) vertex counts
+    numElements = C.numIndices();
+    numVerts = C.numVertices();
 
     // if there are no vertices, there's nothing for us to do
     if( numElements < 1 ) {
         return;
     }
 
-    // OK, we have vertices!
-    float *points = C.getVertices();
-    // #bytes = number of elements * 4 floats/element * bytes/float
-    vSize = numElements * 4 * sizeof(float);
+    format = checkFormat( format );
+    bool packed = format == F_PACKED;
+
+    // OK, we have vertices!  we upload straight from the Canvas,
+    // so none of the data is copied on the CPU side
+    ArrayView<float> points = C.vertexData();
+    ArrayView<float> colors = C.colorData();
+    ArrayView<float> normals = C.normalData();
+    ArrayView<float> uv = C.uvData();
+
+    // per-vertex sizes (in bytes) of each type of data in the
+    // selected format; data the shape doesn't have takes no space
+    long vs = (packed ? 3 : 4) * sizeof(float);
+    long cs = colors.count == 0 ? 0 : (packed ? 4 : 4 * sizeof(float));
+    long ns = normals.count == 0 ? 0 :
+              (packed ? sizeof(GLuint) : 3 * sizeof(float));
+    long ts = uv.count == 0 ? 0 :
+              (packed ? 2 * sizeof(GLushort) : 2 * sizeof(float));
+
+    // #bytes = number of vertices * bytes/vertex
+    vSize = numVerts * vs;
+    cSize = numVerts * cs;
+    nSize = numVerts * ns;
+    tSize = numVerts * ts;
 
     // accumulate the total vertex buffer size
-    GLsizeiptr vbufSize = vSize;
+    GLsizeiptr vbufSize = vSize + cSize + nSize + tSize;
 
-    // get the color data (if there is any)
-    float *colors = C.getColors();
-    if( colors != NULL ) {
-        cSize = numElements * 4 * sizeof(float);
-        vbufSize += cSize;
-    }
+    // get the element data
+    ArrayView<GLuint> elements = C.elementData();
 
-    // get the normal data (if there is any)
-    float *normals = C.getNormals();
-    if( normals != NULL ) {
-        nSize = numElements * 3 * sizeof(float);
-        vbufSize += nSize;
+    // use the smallest index type that can address every vertex
+    eType = smallestIndex( numVerts );
+
+    // #bytes = number of elements * bytes/element
+    eSize = numElements * indexSize( eType );
+
+    // the vertex array records the element buffer binding and the
+    // attribute setup below, so it must be bound while we create them
+    glGenVertexArrays( 1, &vao );
+    glBindVertexArray( vao );
+
+    // first, create the connectivity data, narrowing the
+    // indices as they are written into the buffer
+    ebuffer = makeBuffer( GL_ELEMENT_ARRAY_BUFFER, NULL, eSize );
+    if( !writeElements( elements.data, numElements, eType, eSize ) ) {
+        discardBuffers( vao, vbuffer, ebuffer );
+        return;
     }
 
-    // get the (u,v) data (if there is any)
-    float *uv = C.getUV();
-    if( uv != NULL ) {
-        tSize = numElements * 2 * sizeof(float);
-        vbufSize += tSize;
+    // next, the vertex buffer, containing vertices and "extra" data
+    vbuffer = makeBuffer( GL_ARRAY_BUFFER, NULL, vbufSize );
+
+    // section (blocked) or field (interleaved) offsets are the
+    // sum of the preceding section or field sizes (in bytes)
+    GLintptr offset;
+
+    // distance from one vertex's data to the next, for each type
+    long vStep, cStep, nStep, tStep;
+
+    if( layout == L_INTERLEAVED ) {
+        stride = vs + cs + ns + ts;
+        vOffset = 0;
+        cOffset = vOffset + vs;
+        nOffset = cOffset + cs;
+        tOffset = nOffset + ns;
+        vStep = cStep = nStep = tStep = stride;
+    } else {
+        stride = 0;
+        vOffset = 0;
+        cOffset = vOffset + vSize;
+        nOffset = cOffset + cSize;
+        tOffset = nOffset + nSize;
+        vStep = vs;  cStep = cs;  nStep = ns;  tStep = ts;
     }
 
-    // get the element data
-    GLuint *elements = C.getElements();
-    // #bytes = number of elements * bytes/element
-    eSize = numElements * sizeof(GLuint);
+    if( layout == L_BLOCKED && !packed ) {
 
-    // first, create the connectivity data
-    ebuffer = makeBuffer( GL_ELEMENT_ARRAY_BUFFER, elements, eSize );
+        // the Canvas data is already in this form, so we
+        // use glBufferSubData() calls to do the copying
 
-    // next, the vertex buffer, containing vertices and "extra" data
-    // note that we use glBufferSubData() calls to do the copying
-    vbuffer = makeBuffer( GL_ARRAY_BUFFER, NULL, vbufSize );
+        // copy in the location data
+        glBufferSubData( GL_ARRAY_BUFFER, vOffset, vSize, points.data );
 
-    // copy in the location data
-    glBufferSubData( GL_ARRAY_BUFFER, 0, vSize, points );
+        // add in the color data (if there is any)
+        if( cSize > 0 ) {
+            glBufferSubData( GL_ARRAY_BUFFER, cOffset, cSize, colors.data );
+        }
 
-    // offsets to subsequent sections are the sum of
-    // the preceding section sizes (in bytes)
-    GLintptr offset = vSize;
+        // add in the normal data (if there is any)
+        if( nSize > 0 ) {
+            glBufferSubData( GL_ARRAY_BUFFER, nOffset, nSize, normals.data );
+        }
 
-    // add in the color data (if there is any)
-    if( cSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, cSize, colors );
-        offset += cSize;
-    }
+        // add in the (u,v) data (if there is any)
+        if( tSize > 0 ) {
+            glBufferSubData( GL_ARRAY_BUFFER, tOffset, tSize, uv.data );
+        }
 
-    // add in the normal data (if there is any)
-    if( nSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, nSize, normals );
-        offset += nSize;
-    }
+    } else {
+
+        // write (and convert) the vertices directly into the buffer
+        char *dst = (char *) glMapBufferRange( GL_ARRAY_BUFFER, 0, vbufSize,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+        if( dst == NULL ) {
+            cerr << "*** createBuffers: can't map vertex buffer" << endl;
+            discardBuffers( vao, vbuffer, ebuffer );
+            return;
+        }
 
-    // add in the (u,v) data (if there is any)
-    if( tSize > 0 ) {
-        glBufferSubData( GL_ARRAY_BUFFER, offset, tSize, uv );
-        offset += tSize;
+        long offsets[4] = { vOffset, cOffset, nOffset, tOffset };
+        long steps[4] = { vStep, cStep, nStep, tStep };
+        writeVertices( dst, numVerts, points.data,
+                       cs > 0 ? colors.data : NULL,
+                       ns > 0 ? normals.data : NULL,
+                       ts > 0 ? uv.data : NULL, format, offsets, steps );
+
+        glUnmapBuffer( GL_ARRAY_BUFFER );
     }
 
+    offset = layout == L_INTERLEAVED ? stride * numVerts : tOffset + tSize;
+
     // sanity check!
     if( offset != vbufSize ) {
         cerr << "*** createBuffers: size mismatch, offset "
             << offset << " vbufSize " << vbufSize << endl;
     }
 
-    // NOTE:  'points', 'colors', and 'elements' are dynamically allocated,
-    // but we don't free them here because they will be freed at the next
-    // call to clear() or the get*() functions
+    // record the attribute setup in the vertex array
+    long attribs[4] = { vOffset, cSize > 0 ? cOffset : -1,
+                        nSize > 0 ? nOffset : -1, tSize > 0 ? tOffset : -1 };
+    recordAttribs( format, stride, attribs );
+
+    glBindVertexArray( 0 );
 
     // finally, mark it as set up
     bufferInit = true;
 }
 
 ///
-/// selectBuffers() - bind the correct vertex and element buffers
+/// bind() - select this BufferSet's vertex array for drawing
+///
+void BufferSet::bind( void ) {
+    glBindVertexArray( vao );
+}
+
+///
+/// enableAttrib(which,on) - turn one of the recorded attributes on or off
 ///
-/// @param program   GLSL program object
-/// @param vp        name of the position attribute variable
-/// @param vc        name of the color attribute variable (or NULL)
-/// @param vn        name of the normal attribute variable (or NULL)
-/// @param vt        name of the texture coord attribute variable (or NULL)
+/// @param which   the attribute
+/// @param on      should it be fed from the vertex buffer?
 ///
-void BufferSet::selectBuffers( GLuint program,
-    const char *vp, const char *vc, const char *vn, const char *vt ) {
+void BufferSet::enableAttrib( Attribute which, bool on ) {
+    long sizes[N_ATTRIBS] = { vSize, cSize, nSize, tSize };
 
-    // bind the buffers
-    glBindBuffer( GL_ARRAY_BUFFER, vbuffer );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebuffer );
+    if( on && sizes[which] == 0 ) {
+#if defined(DEBUG)
+        cerr << "enableAttrib(): " << attribNames[which]
+             << " data requested, but there is none" << endl;
+#endif
+        return;
+    }
 
-    // set up the vertex attribute variables
+    glBindVertexArray( vao );
+    if( on ) {
+        glEnableVertexAttribArray( which );
+    } else {
+        glDisableVertexAttribArray( which );
+    }
+    glBindVertexArray( 0 );
+}
 
-    // we always want position data
-#if defined(DEBUG)
-    if( vSize == 0 ) {
-        cerr << "selectBuffers(): Position data requested, but vSize is 0"
-             << endl;
+///
+/// draw(count) - draw this object's triangles
+///
+/// The object's vertex array (or that of its BufferPool) must be bound.
+///
+/// @param count   number of instances to draw
+///
+void BufferSet::draw( int count ) {
+    if( count == 1 ) {
+        glDrawElementsBaseVertex( GL_TRIANGLES, numElements, eType,
+                                  BUFFER_OFFSET(eOffset), baseVertex );
+    } else {
+        glDrawElementsInstancedBaseVertex( GL_TRIANGLES, numElements, eType,
+            BUFFER_OFFSET(eOffset), count, baseVertex );
     }
-#endif
-    GLint loc = getAttribLoc( program , vp );
-    if( loc >= 0 ) {
-        glEnableVertexAttribArray( loc );
-        glVertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, 0,
-                               BUFFER_OFFSET(0) );
+}
+
+///
+/// Constructor
+///
+BufferPool::BufferPool( void ) {
+    format = F_FLOAT;
+    vao = vbuffer = ebuffer = 0;
+    numVerts = numElements = 0;
+    eType = GL_UNSIGNED_INT;
+    stride = 0;
+    vOffset = cOffset = nOffset = tOffset = -1;
+    maxVerts = 0;
+    hasColor = hasNormal = hasUV = false;
+    bufferInit = false;
+}
+
+///
+/// add(canvas,buf,withUV) - add the object currently held in 'canvas'
+///     to the pool, to be drawn using 'buf'
+///
+/// The data is only staged here; nothing is usable until upload().
+///
+/// @param C        the Canvas holding the object
+/// @param buf      the BufferSet which will describe it
+/// @param withUV   keep the object's (u,v) data?
+///
+void BufferPool::add( Canvas &C, BufferSet &buf, bool withUV ) {
+
+    // forget anything the BufferSet was used for before
+    releaseBuffers( buf );
+
+    ArrayView<GLuint> elements = C.elementData();
+    ArrayView<float> points = C.vertexData();
+    ArrayView<float> colors = C.colorData();
+    ArrayView<float> normals = C.normalData();
+    ArrayView<float> uv = C.uvData();
+
+    int nv = C.numVertices();
+    int ne = C.numIndices();
+
+    buf.numVerts = nv;
+    buf.numElements = ne;
+    buf.baseVertex = numVerts;
+    buf.eOffset = numElements;   // in elements until upload()
+    buf.pooled = true;
+    members.push_back( &buf );
+
+    // every vertex in the pool has the same fields, so data the
+    // object doesn't have is filled in with zeroes (which is also
+    // what a shader reads from a disabled attribute)
+    stElements.insert( stElements.end(), elements.data, elements.data + ne );
+    stPoints.insert( stPoints.end(), points.data, points.data + nv * 4 );
+    stColors.resize( (numVerts + nv) * 4 );
+    stNormals.resize( (numVerts + nv) * 3 );
+    stUV.resize( (numVerts + nv) * 2 );
+
+    if( colors.count > 0 ) {
+        copy( colors.data, colors.data + nv * 4,
+              stColors.begin() + numVerts * 4 );
+        hasColor = true;
+    }
+    if( normals.count > 0 ) {
+        copy( normals.data, normals.data + nv * 3,
+              stNormals.begin() + numVerts * 3 );
+        hasNormal = true;
+    }
+    if( uv.count > 0 && withUV ) {
+        copy( uv.data, uv.data + nv * 2, stUV.begin() + numVerts * 2 );
+        hasUV = true;
     }
 
-    // cumulative byte offset for subsequent data sections
-    int offset = vSize;
+    numVerts += nv;
+    numElements += ne;
+    if( nv > maxVerts ) {
+        maxVerts = nv;
+    }
+}
 
-    // do we also want color?
-    if( vc != NULL ) {
-#if defined(DEBUG)
-        if( cSize == 0 ) {
-            cerr << "selectBuffers(): Color data requested, but cSize is 0",
-                 << endl;
-        }
-#endif
-        loc = getAttribLoc( program, vc );
-        if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 4, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
-        }
-        offset += cSize;
+///
+/// share(src,buf) - have 'buf' draw the same mesh as 'src', which must
+///     already have been added to the pool
+///
+/// @param src   the BufferSet whose data is to be shared
+/// @param buf   the BufferSet which will describe the same data
+///
+void BufferPool::share( const BufferSet &src, BufferSet &buf ) {
+
+    releaseBuffers( buf );
+
+    buf.numVerts = src.numVerts;
+    buf.numElements = src.numElements;
+    buf.baseVertex = src.baseVertex;
+    buf.eOffset = src.eOffset;   // in elements until upload()
+    buf.pooled = true;
+    members.push_back( &buf );
+}
+
+///
+/// upload() - create the pool's buffers from the staged objects
+///
+/// Each object's indices are relative to its own first vertex, so
+/// the element type only needs to address the largest object.
+///
+void BufferPool::upload( void ) {
+
+    if( bufferInit ) {
+        cerr << "*** BufferPool::upload: already uploaded" << endl;
+        return;
     }
 
-    // how about a surface normal?
-    if( vn != NULL ) {
-#if defined(DEBUG)
-        if( nSize == 0 ) {
-            cerr << "selectBuffers(): Normal data requested, but nSize is 0",
-                 << endl;
-        }
-#endif
-        loc = getAttribLoc( program, vn );
-        if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 3, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
-        }
-        offset += nSize;
+    if( numElements < 1 ) {
+        return;
     }
 
-    // what about texture coordinates?
-    if( vt != NULL ) {
-#if defined(DEBUG)
-        if( tSize == 0 ) {
-            cerr << "selectBuffers(): Texture data requested, but tSize is 0",
-                 << endl;
-        }
-#endif
-        loc = getAttribLoc( program, vt );
-        if( loc >= 0 ) {
-            glEnableVertexAttribArray( loc );
-            glVertexAttribPointer( loc, 2, GL_FLOAT, GL_FALSE, 0,
-                                   BUFFER_OFFSET(offset) );
-        }
-        offset += tSize;
+    format = checkFormat( format );
+    bool packed = format == F_PACKED;
+
+    // the interleaved layout is the only one which lets every object
+    // share one set of attribute pointers
+    long vs = (packed ? 3 : 4) * sizeof(float);
+    long cs = !hasColor ? 0 : (packed ? 4 : 4 * sizeof(float));
+    long ns = !hasNormal ? 0 : (packed ? sizeof(GLuint) : 3 * sizeof(float));
+    long ts = !hasUV ? 0 :
+              (packed ? 2 * sizeof(GLushort) : 2 * sizeof(float));
+
+    stride = vs + cs + ns + ts;
+    vOffset = 0;
+    cOffset = hasColor ? vOffset + vs : -1;
+    nOffset = hasNormal ? vs + cs : -1;
+    tOffset = hasUV ? vs + cs + ns : -1;
+
+    eType = smallestIndex( maxVerts );
+    long eSize = numElements * BufferSet::indexSize( eType );
+    GLsizeiptr vbufSize = (GLsizeiptr) stride * numVerts;
+
+    glGenVertexArrays( 1, &vao );
+    glBindVertexArray( vao );
+    labelObject( GL_VERTEX_ARRAY, vao, "pool" );
+
+    glGenBuffers( 1, &ebuffer );
+    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, ebuffer );
+    labelObject( GL_BUFFER, ebuffer, "pool elements" );
+    glBufferData( GL_ELEMENT_ARRAY_BUFFER, eSize, NULL, GL_STATIC_DRAW );
+    if( !writeElements( stElements.data(), numElements, eType, eSize ) ) {
+        discardBuffers( vao, vbuffer, ebuffer );
+        return;
+    }
+
+    glGenBuffers( 1, &vbuffer );
+    glBindBuffer( GL_ARRAY_BUFFER, vbuffer );
+    labelObject( GL_BUFFER, vbuffer, "pool vertices" );
+    glBufferData( GL_ARRAY_BUFFER, vbufSize, NULL, GL_STATIC_DRAW );
+    char *dst = (char *) glMapBufferRange( GL_ARRAY_BUFFER, 0, vbufSize,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+    if( dst == NULL ) {
+        cerr << "*** BufferPool::upload: can't map vertex buffer" << endl;
+        discardBuffers( vao, vbuffer, ebuffer );
+        return;
+    }
+
+    long offsets[4] = { vOffset, cOffset, nOffset, tOffset };
+    long steps[4] = { stride, stride, stride, stride };
+    writeVertices( dst, numVerts, stPoints.data(),
+                   hasColor ? stColors.data() : NULL,
+                   hasNormal ? stNormals.data() : NULL,
+                   hasUV ? stUV.data() : NULL, format, offsets, steps );
+    glUnmapBuffer( GL_ARRAY_BUFFER );
+
+    recordAttribs( format, stride, offsets );
+    glBindVertexArray( 0 );
+
+    // fill in the rest of each object's description
+    for( size_t i = 0; i < members.size(); ++i ) {
+        BufferSet &b = *members[i];
+        b.vao = vao;
+        b.vbuffer = vbuffer;
+        b.ebuffer = ebuffer;
+        b.layout = L_INTERLEAVED;
+        b.format = format;
+        b.eType = eType;
+        b.eOffset *= BufferSet::indexSize( eType );
+        b.eSize = b.numElements * BufferSet::indexSize( eType );
+        b.stride = stride;
+        b.vOffset = vOffset;
+        b.cOffset = cOffset;
+        b.nOffset = nOffset;
+        b.tOffset = tOffset;
+        b.vSize = b.numVerts * vs;
+        b.cSize = b.numVerts * cs;
+        b.nSize = b.numVerts * ns;
+        b.tSize = b.numVerts * ts;
+        b.bufferInit = true;
     }
+
+    // the staged data is no longer needed
+    vector<float>().swap( stPoints );
+    vector<float>().swap( stColors );
+    vector<float>().swap( stNormals );
+    vector<float>().swap( stUV );
+    vector<GLuint>().swap( stElements );
+
+    bufferInit = true;
+}
+
+///
+/// bind() - select the pool's vertex array for drawing
+///
+void BufferPool::bind( void ) {
+    glBindVertexArray( vao );
 }
@@ -22,13 +22,34 @@
 
 using namespace std;
 
+#include <vector>
+
 #include "Canvas.h"
+#include "ShaderSetup.h"
 
 //
 // How to calculate an offset into the vertex buffer
 //
 #define BUFFER_OFFSET(i)        ((GLvoid *)(((char *)0) + (i)))
 
+//
+// Vertex buffer layouts
+//
+typedef
+    enum layout_e {
+        L_BLOCKED,      // all locations, then all colors, normals, (u,v)s
+        L_INTERLEAVED   // all the data for each vertex stored together
+    } Layout;
+
+//
+// Vertex data formats
+//
+typedef
+    enum format_e {
+        F_FLOAT,        // everything as 32-bit floats
+        F_PACKED        // XYZ floats, RGBA8, 2_10_10_10 normals, half (u,v)
+    } Format;
+
 //
 // All the relevant information needed to keep
 // track of vertex and element buffers
@@ -37,15 +58,40 @@ using namespace std;
 class BufferSet {
 
 public:
-    // buffer handles
-    GLuint vbuffer, ebuffer;
+    // buffer handles, and the vertex array which records
+    // how the attributes are fetched from them
+    GLuint vbuffer, ebuffer, vao;
 
-    // total number of vertices
+    // total number of elements, and their type (the smallest
+    // of GL_UNSIGNED_BYTE/SHORT/INT which can index every vertex)
     int numElements;
+    GLenum eType;
+
+    // total number of (unique) vertices
+    int numVerts;
 
     // component sizes (bytes)
     long vSize, eSize, tSize, cSize, nSize;
 
+    // vertex buffer layout and data format (set before
+    // calling createBuffers())
+    Layout layout;
+    Format format;
+
+    // byte offsets of the first location, color, normal, and (u,v),
+    // and the distance between vertices (0 if tightly packed)
+    long vOffset, cOffset, nOffset, tOffset;
+    GLsizei stride;
+
+    // where the object's data starts in the buffers: the index of
+    // its first vertex, and the byte offset of its first element
+    // (both 0 unless the object is part of a BufferPool)
+    GLint baseVertex;
+    long eOffset;
+
+    // do the buffers belong to a BufferPool?
+    bool pooled;
+
     // have these already been set up?
     bool bufferInit;
 
@@ -79,6 +125,15 @@ public:
     ///
     GLuint makeBuffer( GLenum target, const void *data, GLsizei size );
 
+    ///
+    /// indexSize(type) - size of one element of an element array
+    ///
+    /// @param type   GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT, or GL_UNSIGNED_INT
+    ///
+    /// @return the size in bytes
+    ///
+    static int indexSize( GLenum type );
+
     ///
     /// createBuffers(canvas) - create a set of buffers for the object
     ///     currently held in 'canvas'.
@@ -88,16 +143,109 @@ public:
     void createBuffers( Canvas &C );
 
     ///
-    /// selectBuffers() - bind the correct vertex and element buffers
+    /// bind() - select this BufferSet's vertex array for drawing
+    ///
+    /// The vertex array was set up by createBuffers() using the fixed
+    /// attribute locations, so it works with any of our shader programs.
+    ///
+    void bind( void );
+
+    ///
+    /// enableAttrib(which,on) - turn one of the recorded attributes on
+    ///     or off (all those with data start out enabled)
+    ///
+    /// @param which   the attribute
+    /// @param on      should it be fed from the vertex buffer?
+    ///
+    void enableAttrib( Attribute which, bool on );
+
+    ///
+    /// draw(count) - draw this object's triangles (its vertex array, or
+    ///     that of its BufferPool, must be bound)
+    ///
+    /// @param count   number of instances to draw
+    ///
+    void draw( int count = 1 );
+
+};
+
+//
+// A pool of objects sharing one vertex buffer, one element buffer, and
+// one vertex array.  Each object is described by its own BufferSet,
+// which records where its data lives in the shared buffers; objects
+// are drawn with glDrawElementsBaseVertex() after a single bind().
+//
+// Pooled data always uses the interleaved layout.  Objects which share
+// a pool's vertex array also share its attribute settings, so
+// enableAttrib() must not be used on them.
+//
+
+class BufferPool {
+
+public:
+    // buffer and vertex array handles
+    GLuint vbuffer, ebuffer, vao;
+
+    // vertex data format (set before calling upload())
+    Format format;
+
+    // element type (shared by all objects in the pool)
+    GLenum eType;
+
+    // totals over all the objects, and the size of the largest
+    int numVerts, numElements, maxVerts;
+
+    // field offsets within a vertex (-1 if absent) and vertex size
+    long vOffset, cOffset, nOffset, tOffset;
+    GLsizei stride;
+
+    // has the pool been uploaded?
+    bool bufferInit;
+
+private:
+    // the objects in the pool
+    vector<BufferSet *> members;
+
+    // data staged by add() until upload() is called
+    vector<float> stPoints, stColors, stNormals, stUV;
+    vector<GLuint> stElements;
+    bool hasColor, hasNormal, hasUV;
+
+public:
+
+    ///
+    /// Constructor
+    ///
+    BufferPool( void );
+
+    ///
+    /// add(canvas,buf,withUV) - add the object currently held in
+    ///     'canvas' to the pool, to be drawn using 'buf'
+    ///
+    /// @param C        the Canvas holding the object
+    /// @param buf      the BufferSet which will describe it
+    /// @param withUV   keep the object's (u,v) data?
+    ///
+    void add( Canvas &C, BufferSet &buf, bool withUV = true );
+
+    ///
+    /// share(src,buf) - have 'buf' draw the same mesh as 'src', which
+    ///     must already have been added to the pool
+    ///
+    /// @param src   the BufferSet whose data is to be shared
+    /// @param buf   the BufferSet which will describe the same data
+    ///
+    void share( const BufferSet &src, BufferSet &buf );
+
+    ///
+    /// upload() - create the pool's buffers from the staged objects
+    ///
+    void upload( void );
+
     ///
-    /// @param program   GLSL program object
-    /// @param vp        name of the position attribute variable
-    /// @param vc        name of the color attribute variable (or NULL)
-    /// @param vn        name of the normal attribute variable (or NULL)
-    /// @param vt        name of the texture coord attribute variable (or NULL)
+    /// bind() - select the pool's vertex array for drawing
     ///
-    void selectBuffers( GLuint program,
-        const char *vp, const char * vc, const char *vn, const char *vt );
+    void bind( void );
 
 };
 
@@ -33,8 +33,15 @@
 //  all the relevant data has been added to the canvas in the proper
 //  sequence.
 //
+//  Vertices are welded before they are handed back to the application:
+//  corners which share identical position, color, normal, and texture
+//  coordinate data are collapsed into a single vertex, and the element
+//  array indexes into the resulting set of unique vertices.
+//
 
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <glm/vec3.hpp>
@@ -50,7 +57,8 @@
 /// @param w width of canvas
 /// @param h height of canvas
 ///
-Canvas::Canvas( int w, int h ) : width(w), height(h) {
+Canvas::Canvas( int w, int h ) : width(w), height(h),
+    weldTable( 0, WeldHash{this}, WeldEqual{this} ) {
     // G++ allows us to use (Color) { ... }, but Visual Studio
     // doesn't, so we do this the long way to keep everyone happy
     Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
@@ -62,6 +70,7 @@ Canvas::Canvas( int w, int h ) : width(w), height(h) {
     uvArray = 0;
     elemArray = 0;
     numElements = 0;
+    numWelded = 0;
 }
 
 ///
@@ -78,6 +87,9 @@ Canvas::~Canvas( void ) {
 ///
 /// Clear the canvas
 ///
+/// The storage used for the canvas data is retained, so that the
+/// next shape can be built without reallocating it.
+///
 void Canvas::clear( void )
 {
     if( pointArray ) {
@@ -104,12 +116,37 @@ void Canvas::clear( void )
     normals.clear();
     uv.clear();
     colors.clear();
+    elements.clear();
+    weldTable.clear();
     numElements = 0;
+    numWelded = 0;
     Color black = { 0.0f, 0.0f, 0.0f, 1.0f };
     currentColor = black;
     currentDepth = -1.0f;
 }
 
+///
+/// Reserve space for additional vertices
+///
+/// This is only a hint; the canvas will still grow as needed, but
+/// reserving space up front avoids reallocating as a shape is built.
+///
+/// @param n         number of vertices about to be added
+/// @param withNorm  will normals be added for them?
+/// @param withUV    will texture coordinates be added for them?
+///
+void Canvas::reserve( int n, bool withNorm, bool withUV )
+{
+    points.reserve( points.size() + n * 4 );
+    elements.reserve( numElements + n );
+    if( withNorm ) {
+        normals.reserve( normals.size() + n * 3 );
+    }
+    if( withUV ) {
+        uv.reserve( uv.size() + n * 2 );
+    }
+}
+
 ///
 /// Set the pixel Z coordinate
 ///
@@ -257,6 +294,64 @@ void Canvas::addTexCoord( TexCoord t )
     uv.push_back( t.v );
 }
 
+    /////////////////////////////////////
+    // Arrays of things
+    /////////////////////////////////////
+
+///
+/// Add an array of vertices to the current shape
+///
+/// @param v   the vertices to be added
+/// @param n   how many there are
+///
+void Canvas::addVertices( const Vertex *v, int n )
+{
+    size_t base = points.size();
+
+    points.resize( base + n * 4 );
+
+    float *dst = &points[base];
+    for( int i = 0; i < n; ++i ) {
+        dst[0] = v[i].x;
+        dst[1] = v[i].y;
+        dst[2] = v[i].z;
+        dst[3] = 1.0f;  // ignore the homogeneous coordinate
+        dst += 4;
+    }
+
+    numElements += n;
+}
+
+///
+/// Add an array of normal vectors to the current shape
+///
+/// @param nv  the normals to be added
+/// @param n   how many there are
+///
+void Canvas::addNormals( const Normal *nv, int n )
+{
+    // a Normal is just three packed floats, so this is a straight copy
+    static_assert( sizeof(Normal) == 3 * sizeof(float), "padded Normal" );
+    const float *src = &nv->x;
+
+    normals.insert( normals.end(), src, src + n * 3 );
+}
+
+///
+/// Add an array of texture coordinates to the current shape
+///
+/// @param t   the texture coordinates to be added
+/// @param n   how many there are
+///
+void Canvas::addTexCoords( const TexCoord *t, int n )
+{
+    // likewise, a TexCoord is two packed floats
+    static_assert( sizeof(TexCoord) == 2 * sizeof(float), "padded TexCoord" );
+    const float *src = &t->u;
+
+    uv.insert( uv.end(), src, src + n * 2 );
+}
+
     /////////////////////////////////////
     // Larger things (triangles, etc.)
     /////////////////////////////////////
@@ -314,6 +409,159 @@ void Canvas::addTextureCoords( TexCoord uv0, TexCoord uv1, TexCoord uv2 )
     addTexCoord( uv2 );
 }
 
+    /////////////////////////////////////
+    // Vertex welding
+    /////////////////////////////////////
+
+//
+// Number of floats per vertex in each of the data arrays
+//
+#define P_COMPS     4
+#define C_COMPS     4
+#define N_COMPS     3
+#define T_COMPS     2
+
+///
+/// Hash the vertex data stored at index i
+///
+/// This is FNV-1a, applied a 32-bit word (one float) at a time
+/// rather than a byte at a time.
+///
+/// @param i   index of the vertex within the data arrays
+/// @return    the hash value
+///
+size_t Canvas::WeldHash::operator()( GLuint i ) const
+{
+    const vector<float> *data[] = { &canvas->points, &canvas->colors,
+                                    &canvas->normals, &canvas->uv };
+    const int comps[] = { P_COMPS, C_COMPS, N_COMPS, T_COMPS };
+    uint64_t h = 14695981039346656037ULL;
+
+    for( int d = 0; d < 4; ++d ) {
+        if( data[d]->empty() ) {
+            continue;
+        }
+        const float *p = data[d]->data() + i * comps[d];
+        for( int c = 0; c < comps[d]; ++c ) {
+            uint32_t w;
+            memcpy( &w, p + c, sizeof(w) );
+            h = (h ^ w) * 1099511628211ULL;
+        }
+    }
+
+    return (size_t) (h ^ (h >> 32));
+}
+
+///
+/// Compare the vertex data stored at indices a and b
+///
+/// Comparison is bitwise, so that only exact duplicates are welded.
+///
+/// @param a   index of the first vertex
+/// @param b   index of the second vertex
+/// @return    true if all the data for the two vertices is identical
+///
+bool Canvas::WeldEqual::operator()( GLuint a, GLuint b ) const
+{
+    const vector<float> *data[] = { &canvas->points, &canvas->colors,
+                                    &canvas->normals, &canvas->uv };
+    const int comps[] = { P_COMPS, C_COMPS, N_COMPS, T_COMPS };
+
+    for( int d = 0; d < 4; ++d ) {
+        if( data[d]->empty() ) {
+            continue;
+        }
+        const float *base = data[d]->data();
+        if( memcmp(base + a * comps[d], base + b * comps[d],
+                   comps[d] * sizeof(float)) != 0 ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///
+/// Weld all vertices added since the last weld
+///
+/// The data arrays hold the unique vertices found so far, followed by
+/// the vertices added since then.  Each new vertex is either matched
+/// with an existing unique vertex or moved down to become the next
+/// unique vertex; either way, its element entry is the index of that
+/// unique vertex.  As the destination never lies beyond the vertex
+/// being examined, this can all be done in place.
+///
+void Canvas::weld( void )
+{
+    int first = elements.size();
+
+    // nothing to do if every vertex already has an element
+    if( first >= numElements ) {
+        return;
+    }
+
+    // number of vertex slots currently in use
+    int total = numWelded + (numElements - first);
+
+    // make sure the optional data arrays agree with the vertex count
+    vector<float> *data[] = { &colors, &normals, &uv };
+    const int comps[] = { C_COMPS, N_COMPS, T_COMPS };
+    const char *names[] = { "color", "normal", "uv" };
+
+    for( int d = 0; d < 3; ++d ) {
+        size_t want = (size_t) total * comps[d];
+        if( !data[d]->empty() && data[d]->size() != want ) {
+            cerr << "*** weld: " << data[d]->size() / comps[d] << " "
+                 << names[d] << " entries for " << total
+                 << " vertices" << endl;
+            data[d]->resize( want, 0.0f );
+        }
+    }
+
+    // the welding table already holds the existing unique vertices
+    weldTable.reserve( total );
+
+    int next = numWelded;
+    elements.reserve( numElements );
+
+    for( int i = numWelded; i < total; ++i ) {
+        unordered_set<GLuint,WeldHash,WeldEqual>::iterator it =
+            weldTable.find( i );
+
+        if( it != weldTable.end() ) {
+            elements.push_back( *it );
+            continue;
+        }
+
+        // a new unique vertex; move its data down into place
+        if( next != i ) {
+            memcpy( &points[next * P_COMPS], &points[i * P_COMPS],
+                    P_COMPS * sizeof(float) );
+            for( int d = 0; d < 3; ++d ) {
+                if( !data[d]->empty() ) {
+                    memcpy( data[d]->data() + next * comps[d],
+                            data[d]->data() + i * comps[d],
+                            comps[d] * sizeof(float) );
+                }
+            }
+        }
+
+        weldTable.insert( next );
+        elements.push_back( next );
+        ++next;
+    }
+
+    // drop the (now redundant) trailing data
+    points.resize( next * P_COMPS );
+    for( int d = 0; d < 3; ++d ) {
+        if( !data[d]->empty() ) {
+            data[d]->resize( next * comps[d] );
+        }
+    }
+
+    numWelded = next;
+}
+
     /////////////////////////////////////
     //
     // Retrieving things from the Canvas
@@ -333,7 +581,9 @@ GLuint *Canvas::getElements( void )
         elemArray = 0;
     }
 
-    int n = numElements;
+    weld();
+
+    int n = elements.size();
 
     if( n > 0 ) {
         // create and fill a new element array
@@ -343,7 +593,7 @@ GLuint *Canvas::getElements( void )
             exit( 1 );
         }
         for( int i = 0; i < n; i++ ) {
-            elemArray[i] = i;
+            elemArray[i] = elements[i];
         }
     }
 
@@ -363,6 +613,8 @@ float *Canvas::getVertices( void )
         pointArray = 0;
     }
 
+    weld();
+
     int n = points.size();
 
     if( n > 0 ) {
@@ -393,6 +645,8 @@ float *Canvas::getNormals( void )
         normalArray = 0;
     }
 
+    weld();
+
     int n = normals.size();
 
     if( n > 0 ) {
@@ -423,6 +677,8 @@ float *Canvas::getUV( void )
         uvArray = 0;
     }
 
+    weld();
+
     int n = uv.size();
 
     if( n > 0 ) {
@@ -453,6 +709,8 @@ float *Canvas::getColors( void )
         colorArray = 0;
     }
 
+    weld();
+
     int n = colors.size();
 
     if( n > 0 ) {
@@ -470,12 +728,77 @@ float *Canvas::getColors( void )
     return colorArray;
 }
 
+///
+/// Build a view of a Canvas data array
+///
+/// @param v   the array
+/// @return    a view of its contents
+///
+template <class T>
+static ArrayView<T> makeView( const vector<T> &v )
+{
+    ArrayView<T> view = { v.empty() ? NULL : v.data(), v.size() };
+
+    return view;
+}
+
+///
+/// Views of the data arrays in this Canvas
+///
+/// These neither allocate nor copy; the views remain valid until
+/// the Canvas is next modified or cleared.
+///
+/// @return A view of the requested data (empty if there is none)
+///
+ArrayView<GLuint> Canvas::elementData( void )
+{
+    weld();
+    return makeView( elements );
+}
+
+ArrayView<float> Canvas::vertexData( void )
+{
+    weld();
+    return makeView( points );
+}
+
+ArrayView<float> Canvas::normalData( void )
+{
+    weld();
+    return makeView( normals );
+}
+
+ArrayView<float> Canvas::uvData( void )
+{
+    weld();
+    return makeView( uv );
+}
+
+ArrayView<float> Canvas::colorData( void )
+{
+    weld();
+    return makeView( colors );
+}
+
 ///
 /// Retrieve the vertex count from this Canvas
 ///
-/// @return The number of vertices in the canvas
+/// @return The number of unique (welded) vertices in the canvas
 ///
 int Canvas::numVertices( void )
+{
+    weld();
+
+    return numWelded;
+}
+
+///
+/// Retrieve the element count from this Canvas
+///
+/// @return The number of vertices added to the canvas (one element
+///         for each)
+///
+int Canvas::numIndices( void )
 {
     return numElements;
 }
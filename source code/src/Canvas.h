@@ -34,6 +34,11 @@
 //  all the relevant data has been added to the canvas in the proper
 //  sequence.
 //
+//  Vertices are welded before they are handed back to the application:
+//  corners which share identical position, color, normal, and texture
+//  coordinate data are collapsed into a single vertex, and the element
+//  array indexes into the resulting set of unique vertices.
+//
 
 #ifndef CANVAS_H_
 #define CANVAS_H_
@@ -50,6 +55,20 @@
 using namespace std;
 
 #include <vector>
+#include <unordered_set>
+
+///
+/// Non-owning view of one of the data arrays held by a Canvas.  A view
+/// is only valid until the next change to the Canvas it came from.
+///
+
+template <class T>
+struct ArrayView {
+    const T *data;      // the first entry, or NULL if there is no data
+    size_t count;       // number of entries
+
+    size_t bytes( void ) const { return count * sizeof(T); }
+};
 
 ///
 /// Simple canvas class that allows for pixel-by-pixel rendering.
@@ -85,8 +104,38 @@ class Canvas {
 
     // element count and connectivity data
     int numElements;
+    vector<GLuint> elements;
     GLuint *elemArray;
 
+    // number of unique vertices at the front of the data arrays
+    int numWelded;
+
+    //
+    // vertex welding support
+    //
+    // The welding table holds the indices of the unique vertices;
+    // these functors hash and compare the vertex data stored at
+    // two indices in the data arrays.
+    //
+    struct WeldHash {
+        const Canvas *canvas;
+        size_t operator()( GLuint i ) const;
+    };
+
+    struct WeldEqual {
+        const Canvas *canvas;
+        bool operator()( GLuint a, GLuint b ) const;
+    };
+
+    // indices of the unique vertices found so far; kept between
+    // shapes so that its storage is reused
+    unordered_set<GLuint,WeldHash,WeldEqual> weldTable;
+
+    ///
+    /// Weld all vertices added since the last weld
+    ///
+    void weld( void );
+
     //
     // other Canvas defaults
     //
@@ -118,8 +167,23 @@ public:
     ///
     /// Clear the canvas
     ///
+    /// The storage used for the canvas data is retained, so that the
+    /// next shape can be built without reallocating it.
+    ///
     void clear( void );
 
+    ///
+    /// Reserve space for additional vertices
+    ///
+    /// This is only a hint; the canvas will still grow as needed, but
+    /// reserving space up front avoids reallocating as a shape is built.
+    ///
+    /// @param n         number of vertices about to be added
+    /// @param withNorm  will normals be added for them?
+    /// @param withUV    will texture coordinates be added for them?
+    ///
+    void reserve( int n, bool withNorm = true, bool withUV = true );
+
     ///
     /// Set the pixel Z coordinate
     ///
@@ -201,6 +265,34 @@ public:
     ///
     void addNormal( Normal n );
 
+    /////////////////////////////////////
+    // Arrays of things
+    /////////////////////////////////////
+
+    ///
+    /// Add an array of vertices to the current shape
+    ///
+    /// @param v   the vertices to be added
+    /// @param n   how many there are
+    ///
+    void addVertices( const Vertex *v, int n );
+
+    ///
+    /// Add an array of normal vectors to the current shape
+    ///
+    /// @param nv  the normals to be added
+    /// @param n   how many there are
+    ///
+    void addNormals( const Normal *nv, int n );
+
+    ///
+    /// Add an array of texture coordinates to the current shape
+    ///
+    /// @param t   the texture coordinates to be added
+    /// @param n   how many there are
+    ///
+    void addTexCoords( const TexCoord *t, int n );
+
     /////////////////////////////////////
     // Larger things (triangles, etc.)
     /////////////////////////////////////
@@ -279,13 +371,35 @@ public:
     ///
     float *getColors( void );
 
+    ///
+    /// Views of the data arrays in this Canvas
+    ///
+    /// These neither allocate nor copy; the views remain valid until
+    /// the Canvas is next modified or cleared.
+    ///
+    /// @return A view of the requested data (empty if there is none)
+    ///
+    ArrayView<GLuint> elementData( void );
+    ArrayView<float> vertexData( void );
+    ArrayView<float> normalData( void );
+    ArrayView<float> uvData( void );
+    ArrayView<float> colorData( void );
+
     ///
     /// Retrieve the vertex count from this Canvas
     ///
-    /// @return The number of vertices in the canvas
+    /// @return The number of unique (welded) vertices in the canvas
     ///
     int numVertices( void );
 
+    ///
+    /// Retrieve the element count from this Canvas
+    ///
+    /// @return The number of vertices added to the canvas (one element
+    ///         for each)
+    ///
+    int numIndices( void );
+
 };
 
 #endif
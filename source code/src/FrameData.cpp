@@ -0,0 +1,122 @@
+//
+//  FrameData.cpp
+//
+//  Per-frame shader data shared by all the shader programs.
+//
+
+#include <cstring>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "FrameData.h"
+
+#include "Lighting.h"
+#include "ShaderSetup.h"
+#include "Utils.h"
+#include "Viewing.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// contents of the "Frame" uniform block (must match the std140
+// layout of the block in the shaders)
+typedef struct framedata_s {
+    glm::mat4 viewMat;
+    glm::mat4 projMat;
+    glm::vec4 lightPosition;
+    glm::vec4 lightColor;
+    glm::vec4 ambientLight;
+} FrameData;
+
+static_assert( sizeof(FrameData) == 176, "FrameData must match std140" );
+
+// the buffer, and what was last put into it
+static GLuint frameBuffer;
+static FrameData current;
+static bool valid = false;
+
+// was the buffer created?
+static bool inUse = false;
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Create the per-frame uniform buffer and bind it to its binding point
+///
+/// @return true if uniform buffers are supported, else false (in which
+///         case the data must be sent to each program as uniforms)
+///
+bool initFrameData( void )
+{
+    if( !(GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object) ) {
+        return( false );
+    }
+
+    glGenBuffers( 1, &frameBuffer );
+    glBindBuffer( GL_UNIFORM_BUFFER, frameBuffer );
+    labelObject( GL_BUFFER, frameBuffer, "Frame" );
+    glBufferData( GL_UNIFORM_BUFFER, sizeof(FrameData), NULL,
+                  GL_DYNAMIC_DRAW );
+    glBindBufferBase( GL_UNIFORM_BUFFER, B_FRAME, frameBuffer );
+    valid = false;
+    inUse = true;
+
+    return( true );
+}
+
+///
+/// Is the per-frame uniform buffer in use?
+///
+/// @return true if initFrameData() succeeded, else false
+///
+bool frameDataInUse( void )
+{
+    return( inUse );
+}
+
+///
+/// Bring the per-frame uniform buffer up to date
+///
+/// The data is only uploaded if the camera, projection, or lighting
+/// has changed since the last call.
+///
+/// @return true if the buffer was updated, else false
+///
+bool updateFrameData( void )
+{
+    FrameData data;
+
+    if( !inUse ) {
+        return( false );
+    }
+
+    data.viewMat = viewMatrix();
+    data.projMat = projectionMatrix();
+    getLighting( data.lightPosition, data.lightColor, data.ambientLight );
+
+    if( valid && memcmp( &data, &current, sizeof(data) ) == 0 ) {
+        return( false );
+    }
+
+    glBindBuffer( GL_UNIFORM_BUFFER, frameBuffer );
+    glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof(data), &data );
+    ++renderStats.uniforms;
+
+    current = data;
+    valid = true;
+
+    return( true );
+}
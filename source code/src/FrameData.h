@@ -0,0 +1,47 @@
+//
+//  FrameData.h
+//
+//  Per-frame shader data shared by all the shader programs.
+//
+//  The camera, projection, and lighting data are the same for every
+//  object drawn in a frame, so they are kept in a single uniform buffer
+//  bound to the B_FRAME binding point (see ShaderSetup.h), where every
+//  shader program's "Frame" uniform block finds it.
+//
+
+#ifndef FRAMEDATA_H_
+#define FRAMEDATA_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+///
+/// Create the per-frame uniform buffer and bind it to its binding point
+///
+/// @return true if uniform buffers are supported, else false (in which
+///         case the data must be sent to each program as uniforms)
+///
+bool initFrameData( void );
+
+///
+/// Is the per-frame uniform buffer in use?
+///
+/// @return true if initFrameData() succeeded, else false
+///
+bool frameDataInUse( void );
+
+///
+/// Bring the per-frame uniform buffer up to date
+///
+/// The data is only uploaded if the camera, projection, or lighting
+/// has changed since the last call.
+///
+/// @return true if the buffer was updated, else false
+///
+bool updateFrameData( void );
+
+#endif
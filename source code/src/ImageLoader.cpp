@@ -0,0 +1,301 @@
+//
+//  ImageLoader.cpp
+//
+//  Background decoding of image files.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SOIL.h>
+
+#include "ImageLoader.h"
+#include "Profile.h"
+#include "TextureCache.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// the files being decoded
+static const char *const *files;
+static int numFiles;
+
+// hand back BC1-compressed images rather than pixels?
+static bool compress;
+
+// size each image is resampled to (NULL to leave them alone)
+static const ImageSize *imageSizes;
+
+// report the images added to the cache?  (always in DEBUG builds;
+// otherwise, only when profiling)
+static bool verbose;
+
+// index of the next file to be decoded
+static atomic<int> nextFile;
+
+// images which have been decoded but not yet collected, and the
+// number collected so far
+static deque<Image> done;
+static int collected;
+
+static mutex doneLock;
+static condition_variable ready;
+
+// the worker threads
+static vector<thread> workers;
+
+// SOIL (and the stb_image code inside it) keeps its error string and
+// zlib tables in unsynchronized globals, so only one thread at a time
+// may decode.  That part of start-up is serialized; the workers only
+// overlap the rest of their jobs (hashing, resampling, building mip
+// chains, compressing, and the cache) with each other and with the
+// main thread.  Decoding in parallel would need a thread-safe decoder,
+// and SOIL is the only one the program has
+static mutex soilLock;
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Worker thread: decode files until there are none left
+///
+static void worker( void )
+{
+    int i;
+
+    while( (i = nextFile++) < numFiles ) {
+        Image img;
+        uint64_t key;
+
+        img.index = i;
+        img.path = files[i];
+        img.width = img.height = 0;
+        img.mips.levels = 0;
+        img.compressed.levels = 0;
+
+        // compressed images come from the cache when they can (and
+        // are the right size); otherwise, the image is decoded,
+        // resampled, and its mip chain built (and compressed and
+        // cached, if need be)
+        const ImageSize *size = imageSizes ? &imageSizes[i] : NULL;
+        bool cached = compress &&
+                      cacheLoad( files[i], key, img.compressed ) &&
+                      (size == NULL ||
+                       (img.compressed.width == size->width &&
+                        img.compressed.height == size->height));
+        if( !cached ) {
+            img.compressed = CompressedImage();
+            unsigned char *data;
+            {
+                lock_guard<mutex> guard( soilLock );
+                data = SOIL_load_image( files[i], &img.width, &img.height,
+                                        0, SOIL_LOAD_RGB );
+            }
+            if( data != NULL ) {
+                if( size != NULL && (img.width != size->width ||
+                                     img.height != size->height) ) {
+                    vector<unsigned char> resized;
+                    resizeImage( data, img.width, img.height,
+                                 size->width, size->height, resized );
+                    img.width = size->width;
+                    img.height = size->height;
+                    buildMips( resized.data(), img.width, img.height,
+                               img.mips );
+                } else {
+                    buildMips( data, img.width, img.height, img.mips );
+                }
+                SOIL_free_image_data( data );
+            }
+            if( compress && img.mips.levels > 0 ) {
+                if( verbose ) {
+                    fprintf( stderr,
+                             "compressing '%s' into the texture cache\n",
+                             files[i] );
+                }
+                compressImage( img.mips, img.compressed );
+                cacheStore( key, img.compressed );
+                img.mips = MipChain();
+            }
+        }
+        if( img.compressed.levels > 0 ) {
+            img.width = img.compressed.width;
+            img.height = img.compressed.height;
+        }
+
+        {
+            lock_guard<mutex> guard( doneLock );
+            done.push_back( move( img ) );
+        }
+        ready.notify_one();
+    }
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Find the size of an image file without decoding it
+///
+/// Only the PNG and JPEG headers are understood.
+///
+/// @param path     the file
+/// @param width    filled in with its width
+/// @param height   filled in with its height
+///
+/// @return false if the file can't be read or its format isn't known
+///
+bool imageFileSize( const char *path, int &width, int &height )
+{
+    FILE *fp = fopen( path, "rb" );
+    if( fp == NULL ) {
+        return( false );
+    }
+
+    unsigned char b[24];
+    bool found = false;
+
+    if( fread( b, 1, 2, fp ) == 2 && b[0] == 0x89 && b[1] == 'P' ) {
+        // PNG: the signature, then the IHDR chunk, which starts with
+        // the big-endian width and height (neither of which can be
+        // usefully as large as 2^24)
+        if( fread( b + 2, 1, 22, fp ) == 22 &&
+            memcmp( b + 12, "IHDR", 4 ) == 0 && b[16] == 0 && b[20] == 0 ) {
+            width = (b[17] << 16) | (b[18] << 8) | b[19];
+            height = (b[21] << 16) | (b[22] << 8) | b[23];
+            found = true;
+        }
+    } else if( b[0] == 0xff && b[1] == 0xd8 ) {
+        // JPEG: step from marker to marker until a start-of-frame,
+        // which holds the height and width (C4, C8, and CC are other
+        // markers in the same range); the image data starts at SOS
+        // (DA), so there is no frame header after that
+        int c;
+        while( (c = getc( fp )) != EOF ) {
+            if( c != 0xff ) {
+                break;
+            }
+            int marker;
+            while( (marker = getc( fp )) == 0xff ) {
+            }
+            if( marker == EOF || marker == 0xd9 || marker == 0xda ) {
+                break;
+            }
+            if( marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7) ) {
+                continue;   // no length or data
+            }
+            if( fread( b, 1, 2, fp ) != 2 ) {
+                break;
+            }
+            int length = (b[0] << 8) | b[1];
+            if( marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 &&
+                marker != 0xc8 && marker != 0xcc ) {
+                if( fread( b, 1, 5, fp ) == 5 ) {
+                    height = (b[1] << 8) | b[2];
+                    width = (b[3] << 8) | b[4];
+                    found = true;
+                }
+                break;
+            }
+            if( length < 2 || fseek( fp, length - 2, SEEK_CUR ) != 0 ) {
+                break;
+            }
+        }
+    }
+    fclose( fp );
+
+    return( found && width > 0 && height > 0 );
+}
+
+///
+/// Start decoding a list of image files
+///
+/// @param paths   the files (which must remain valid until all the
+///                images have been collected)
+/// @param n       how many there are
+/// @param bc1     hand back BC1-compressed images, from the texture
+///                cache if possible, rather than pixels?
+/// @param sizes   the size to resample each image to (NULL to leave
+///                them at their own sizes); must remain valid, as the
+///                paths must
+///
+void startImageLoads( const char *const *paths, int n, bool bc1,
+                      const ImageSize *sizes )
+{
+    finishImageLoads();
+
+    files = paths;
+    numFiles = n;
+    compress = bc1;
+    imageSizes = sizes;
+#if defined(DEBUG)
+    verbose = true;
+#else
+    verbose = profiling();
+#endif
+    nextFile = 0;
+    collected = 0;
+    done.clear();
+
+    // the main thread has work of its own, but spends much of it
+    // waiting on the driver, so use every core; each worker exits
+    // once there are no files left
+    int count = min( n, max( 1, (int) thread::hardware_concurrency() ) );
+    for( int i = 0; i < count; ++i ) {
+        workers.push_back( thread( worker ) );
+    }
+}
+
+///
+/// Wait for the worker threads to exit
+///
+/// Files which haven't been started yet are skipped, and images which
+/// haven't been collected are thrown away.
+///
+void finishImageLoads( void )
+{
+    nextFile = numFiles;
+    for( size_t i = 0; i < workers.size(); ++i ) {
+        workers[i].join();
+    }
+    workers.clear();
+
+    done.clear();
+    collected = numFiles;
+}
+
+///
+/// Collect the next image to finish decoding, waiting for one if need be
+///
+/// @param img   filled in with the image
+///
+/// @return false once every image has been collected
+///
+bool nextImage( Image &img )
+{
+    if( collected == numFiles ) {
+        return( false );
+    }
+
+    {
+        PROFILE_SCOPE( "nextImage wait" );
+        unique_lock<mutex> guard( doneLock );
+        ready.wait( guard, []{ return !done.empty(); } );
+        img = move( done.front() );
+        done.pop_front();
+    }
+    ++collected;
+
+    return( true );
+}
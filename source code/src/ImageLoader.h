@@ -0,0 +1,96 @@
+//
+//  ImageLoader.h
+//
+//  Background decoding of image files.
+//
+//  Decoding the texture images (and building their mip chains) is the
+//  slowest part of start-up, and needs no GL context, so it is done by
+//  a pool of worker threads while the main thread compiles shaders and
+//  builds the geometry.  Images are handed back to the main thread
+//  (which owns the context) in the order they finish, so each can be
+//  uploaded as soon as it's ready.
+//
+//  Images are handed back as RGBA8 mip chains, or BC1-compressed, in
+//  which case they come from the texture cache when they can (see
+//  TextureCache.h); images which aren't in the cache yet are
+//  compressed, and added to it, by the workers.  Images can also be
+//  resampled to given sizes (before their mip chains are built), so
+//  that images of similar sizes can share a texture array.
+//
+//  Only one set of loads can be in progress at a time.
+//
+
+#ifndef IMAGELOADER_H_
+#define IMAGELOADER_H_
+
+#include "TextureCache.h"
+
+///
+/// A decoded image
+///
+/// If the image couldn't be decoded, both 'mips' and 'compressed' have
+/// no levels.
+///
+typedef struct image_s {
+    int index;              // position in the list given to startImageLoads()
+    const char *path;       // the file it came from
+    int width, height;
+    MipChain mips;              // the mip chain (if not compressed)
+    CompressedImage compressed; // the compressed mip chain (if asked for)
+} Image;
+
+///
+/// A size to resample an image to
+///
+typedef struct imagesize_s {
+    int width, height;
+} ImageSize;
+
+///
+/// Find the size of an image file without decoding it
+///
+/// Only the PNG and JPEG headers are understood.
+///
+/// @param path     the file
+/// @param width    filled in with its width
+/// @param height   filled in with its height
+///
+/// @return false if the file can't be read or its format isn't known
+///
+bool imageFileSize( const char *path, int &width, int &height );
+
+///
+/// Start decoding a list of image files
+///
+/// @param paths   the files (which must remain valid until all the
+///                images have been collected)
+/// @param n       how many there are
+/// @param bc1     hand back BC1-compressed images, from the texture
+///                cache if possible, rather than pixels?
+/// @param sizes   the size to resample each image to (NULL to leave
+///                them at their own sizes); must remain valid, as the
+///                paths must
+///
+void startImageLoads( const char *const *paths, int n, bool bc1 = false,
+                      const ImageSize *sizes = NULL );
+
+///
+/// Collect the next image to finish decoding, waiting for one if need be
+///
+/// @param img   filled in with the image
+///
+/// @return false once every image has been collected
+///
+bool nextImage( Image &img );
+
+///
+/// Wait for the worker threads to exit
+///
+/// Call this once the images have all been collected, or to abandon
+/// the loads; the workers must not outlive the program's globals.
+/// Files which haven't been started yet are skipped, and images which
+/// haven't been collected are thrown away.
+///
+void finishImageLoads( void );
+
+#endif
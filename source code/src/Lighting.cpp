@@ -14,6 +14,7 @@
 #include "Lighting.h"
 
 #include "Models.h"
+#include "ShaderSetup.h"
 #include "Utils.h"
 
 #include <glm/vec4.hpp>
@@ -43,18 +44,35 @@ void setLighting( GLuint program )
     GLint loc;
 
     // Lighting parameters
-    loc = getUniformLoc( program, "lightPosition" );
+    loc = uniformLoc( program, U_LIGHTPOSITION );
     if( loc >= 0 ) {
         glUniform4fv( loc, 1, glm::value_ptr(lightpos) );
+        ++renderStats.uniforms;
     }
 
-    loc = getUniformLoc( program, "lightColor" );
+    loc = uniformLoc( program, U_LIGHTCOLOR );
     if( loc >= 0 ) {
         glUniform4fv( loc, 1, glm::value_ptr(lightcolor) );
+        ++renderStats.uniforms;
     }
 
-    loc = getUniformLoc( program, "ambientLight" );
+    loc = uniformLoc( program, U_AMBIENTLIGHT );
     if( loc >= 0 ) {
         glUniform4fv( loc, 1, glm::value_ptr(amblight) );
+        ++renderStats.uniforms;
     }
 }
+
+///
+/// This function retrieves the current lighting parameters.
+///
+/// @param position  Filled in with the light position (world space)
+/// @param color     Filled in with the light color
+/// @param ambient   Filled in with the ambient light color
+///
+void getLighting( glm::vec4 &position, glm::vec4 &color, glm::vec4 &ambient )
+{
+    position = lightpos;
+    color = lightcolor;
+    ambient = amblight;
+}
@@ -38,4 +38,13 @@ extern glm::vec4 lightpos;
 ///
 void setLighting( GLuint program );
 
+///
+/// This function retrieves the current lighting parameters.
+///
+/// @param position  Filled in with the light position (world space)
+/// @param color     Filled in with the light color
+/// @param ambient   Filled in with the ambient light color
+///
+void getLighting( glm::vec4 &position, glm::vec4 &color, glm::vec4 &ambient );
+
 #endif
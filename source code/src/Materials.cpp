@@ -16,7 +16,10 @@
 #include "Materials.h"
 
 #include "Models.h"
+#include "Profile.h"
 #include "Lighting.h"
+#include "ShaderSetup.h"
+#include "Textures.h"
 #include "Utils.h"
 
 #include <glm/vec3.hpp>
@@ -127,11 +130,95 @@ static glm::vec4 cyl3_diffuse(0.89f, 0.00f, 0.00f, 1.00f);
 static glm::vec4 cyl4_ambient(0.50f, 0.10f, 0.90f, 1.00f);
 static glm::vec4 cyl4_diffuse(0.89f, 0.00f, 0.00f, 1.00f);
 
+// per-object material colors (order depends upon the Object type in
+// Models.h); only the objects drawn with Phong shading use these
+static const glm::vec4 *ambientColors[N_OBJECTS] = {
+    &cyl_ambient, &cyl_ambient, &sph_ambient, &sph_ambient, &sph_ambient,
+    &cube_ambient, &cube2_ambient, &cube3_ambient, &semisph_ambient,
+    &prism_ambient, &prism2_ambient, &plate_ambient, &plate2_ambient,
+    &bread1_ambient, &bread2_ambient, &bread3_ambient, &teapot_ambient,
+    &cyl2_ambient, &bread1a_ambient, &bread2a_ambient, &bread3a_ambient,
+    &fork_ambient, &cyl3_ambient, &cyl4_ambient
+};
+
+static const glm::vec4 *diffuseColors[N_OBJECTS] = {
+    &cyl_diffuse, &cyl_diffuse, &sph_diffuse, &sph_diffuse, &sph_diffuse,
+    &cube_diffuse, &cube2_diffuse, &cube3_diffuse, &semisph_diffuse,
+    &prism_diffuse, &prism2_diffuse, &plate_diffuse, &plate2_diffuse,
+    &bread1_diffuse, &bread2_diffuse, &bread3_diffuse, &teapot_diffuse,
+    &cyl2_diffuse, &bread1a_diffuse, &bread2a_diffuse, &bread3a_diffuse,
+    &fork_diffuse, &cyl3_diffuse, &cyl4_diffuse
+};
+
+// image file for each object's texture (order depends upon the Object
+// type in Models.h), or NULL for objects drawn with Phong shading
+static const char *const texFiles[N_OBJECTS] = {
+    "pa092.png",            // Cylinder
+    "coffee.jpg",           // Discs
+    NULL,                   // Sphere
+    NULL,                   // Sphere2
+    NULL,                   // Sphere3
+    "wood047.jpg",          // Cube
+    "wood039.jpg",          // Cube2
+    "cloth018.png",         // Cube3
+    "basket-texture.jpg",   // SemiSphere
+    NULL,                   // Prism
+    NULL,                   // Prism2
+    "pa092.png",            // Plate
+    "platebottom1.jpg",     // Plateside
+    "breadtop.jpg",         // Bread1
+    "breadtop.jpg",         // Bread2
+    "breadtop.jpg",         // Bread3
+    NULL,                   // Teapot
+    "pa092.png",            // Cylinder2
+    "breadtop.png",         // Bread1a
+    "breadtop.png",         // Bread2a
+    "breadtop.png",         // Bread3a
+    NULL,                   // Fork
+    "basket-texture.jpg",   // Cylinder3
+    "platebottom1.jpg"      // Cylinder4
+};
+
+// image seen on the back faces of every textured object (texture unit
+// 0 in the original code, where the back face sampler was never set)
+static const char *const backFile = "wood039.jpg";
+
+// where the back face texture is; the shaders are told this directly,
+// so it doesn't matter which array or layer it ends up in
+static TextureRef backRef;
+
+// texture array (by unit) and layer holding each object's texture
+// (from the texture registry); the unit is -1 for objects drawn with
+// Phong shading
+static TextureRef texRefs[N_OBJECTS];
+
 
 
 
 // Add any global definitions and/or variables you need here.
 
+///
+/// Register each object's texture, and start decoding the texture
+/// images in the background; initTextures() uploads them as they
+/// become available.
+///
+/// @param compress   use BC1-compressed (and cached) textures if we can?
+/// @param sampler    how the textures are to be sampled
+///
+void startTextureLoads(bool compress, const Sampler &sampler)
+{
+    backRef = registerTexture(backFile, sampler);
+    for (int obj = 0; obj < N_OBJECTS; ++obj) {
+        if (texFiles[obj] == NULL) {
+            texRefs[obj].unit = -1;
+            texRefs[obj].layer = 0;
+        } else {
+            texRefs[obj] = registerTexture(texFiles[obj], sampler);
+        }
+    }
+    loadTextures(compress);
+}
+
 ///
 /// This function initializes all texture-related data structures for
 /// the program.  This is where texture buffers should be created, where
@@ -155,177 +242,9 @@ void flipVertically(unsigned char* image, int width, int height, int channels) {
 
 void initTextures(void)
 {
-    // Load and configure heads texture
-    int width, height;
-    unsigned char* image;
-    GLuint  textureWall, textureDisc, texturetable, textureBack, texturebasket, texturecloth,textureplate, textureside,texturebreadtop,texturebreadside ;
-
-    // Generate texture IDs for all the texturing
-    glGenTextures(1, &textureWall);
-    glGenTextures(1, &textureDisc);
-    glGenTextures(1, &texturetable);
-    glGenTextures(1, &textureBack);
-    glGenTextures(1, &texturebasket);
-    glGenTextures(1, &texturecloth);
-    glGenTextures(1, &textureplate);
-    glGenTextures(1, &texturebreadtop);
-    glGenTextures(1, &texturebreadside);
-    glGenTextures(1, &textureside);
-
-
-
-
-    // Load table texture
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texturetable);
-    image = SOIL_load_image("wood039.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load backgorund texture
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, textureBack);
-    image = SOIL_load_image("wood047.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load wall texture
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, textureWall);
-    image = SOIL_load_image("pa092.png", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-
-    // Load  disc texture
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, textureDisc);
-    image = SOIL_load_image("coffee.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load basket texture
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, texturebasket);
-    image = SOIL_load_image("basket-texture.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load basket texture
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, texturecloth);
-    image = SOIL_load_image("cloth018.png", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load plate texture
-    glActiveTexture(GL_TEXTURE6);
-    glBindTexture(GL_TEXTURE_2D, textureplate);
-    image = SOIL_load_image("platebottom1.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load breadtop texture
-    glActiveTexture(GL_TEXTURE7);
-    glBindTexture(GL_TEXTURE_2D, texturebreadtop);
-    image = SOIL_load_image("breadtop.png", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load breadside texture
-    glActiveTexture(GL_TEXTURE8);
-    glBindTexture(GL_TEXTURE_2D, texturebreadside);
-    image = SOIL_load_image("breadtop.jpg", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
-
-    // Load plate texture
-    glActiveTexture(GL_TEXTURE9);
-    glBindTexture(GL_TEXTURE_2D, textureside);
-    image = SOIL_load_image("plate.png", &width, &height, 0, SOIL_LOAD_RGB);
-    if (image == 0) {
-        printf("SOIL loading error: '%s'\n", SOIL_last_result());
-    }
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    SOIL_free_image_data(image);
+    PROFILE_SCOPE("initTextures");
 
+    uploadTextures();
 }
 ///
 /// This function sets up the appearance parameters for the object.
@@ -344,14 +263,16 @@ void setMaterials(GLuint program, Object obj, bool usingTextures)
     ///////////////////////////////////////////////////
 
     // Set the specular exponent for the object
-    GLint loc = getUniformLoc(program, "specExp");
+    GLint loc = uniformLoc(program, U_SPECEXP);
     glUniform1f(loc, specExp[obj]);
+    ++renderStats.uniforms;
 
 
     // Send down the reflective coefficients
-    loc = getUniformLoc(program, "kCoeff");
+    loc = uniformLoc(program, U_KCOEFF);
     if (loc >= 0) {
         glUniform3fv(loc, 1, glm::value_ptr(k));
+        ++renderStats.uniforms;
     }
 
     ///////////////////////////////////////////////////////////
@@ -359,130 +280,171 @@ void setMaterials(GLuint program, Object obj, bool usingTextures)
     ///////////////////////////////////////////////////////////
     
     // texturing
-    switch (obj) {
-    case Cylinder:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 2); // cylinder using texture unit 2
-        break;
-    case Discs:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 3);
-        break;
-    case Cube:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 1);
-        break;
-    case Cube2:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 0);
-        break;
-    case SemiSphere:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 4);
-        break;
-    case Cube3:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 5);
-        break;
-    case Cylinder2:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 2); // cylinder using texture unit 2
-        break;
-    case Plate:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 2);
-        break;
-    case Plateside:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 6);
-        break;
-    case Bread1a:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 7);
-        break;
-    case Bread2a:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 7);
-        break;
-    case Bread3a:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 7);
-        break;
-    case Bread1:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 8);
-        break;
-    case Bread2:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 8);
-        break;
-    case Bread3:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 8);
-        break;
-    case Cylinder3:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 4);
-        break;
-    case Cylinder4:
-        glUniform1i(glGetUniformLocation(program, "texturefront"), 6);
-        break;
-      
-    default:
-       
-        // specular color is identical for the objects
-        loc = getUniformLoc(program, "specularColor");
+    if (texRefs[obj].unit >= 0) {
+        glUniform1i(uniformLoc(program, U_TEXTURES), texRefs[obj].unit);
+        glUniform1i(uniformLoc(program, U_LAYER), texRefs[obj].layer);
+        renderStats.uniforms += 2;
+        ++renderStats.textures;
+        return;
+    }
+
+    // specular color is identical for the objects
+    loc = uniformLoc(program, U_SPECULARCOLOR);
+    if (loc >= 0) {
+        glUniform4fv(loc, 1, glm::value_ptr(specular));
+        ++renderStats.uniforms;
+    }
+
+    // ambient and diffuse vary from one object to another
+    GLint dloc = uniformLoc(program, U_DIFFUSECOLOR);
+    GLint aloc = uniformLoc(program, U_AMBIENTCOLOR);
+    if (aloc >= 0) {
+        glUniform4fv(aloc, 1, glm::value_ptr(*ambientColors[obj]));
+        ++renderStats.uniforms;
+    }
+    if (dloc >= 0) {
+        glUniform4fv(dloc, 1, glm::value_ptr(*diffuseColors[obj]));
+        ++renderStats.uniforms;
+    }
+}
+
+///
+/// This function sets up the per-instance appearance parameters for a
+/// group of objects drawn with one instanced draw.  The material
+/// constants and the texture are sent separately (see
+/// setMaterialConstants() and setMaterialTexture()).
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///                  parameter values are to be sent
+/// @param objs      The objects, in instance order
+/// @param n         How many there are (at most MAX_INSTANCES)
+///
+void setInstanceMaterials(GLuint program, const Object *objs, int n)
+{
+    GLfloat exps[MAX_INSTANCES];
+    glm::vec4 ambient[MAX_INSTANCES], diffuse[MAX_INSTANCES];
+
+    for (int i = 0; i < n; ++i) {
+        exps[i] = specExp[objs[i]];
+        ambient[i] = *ambientColors[objs[i]];
+        diffuse[i] = *diffuseColors[objs[i]];
+    }
+
+    // the specular exponent is per instance
+    GLint loc = uniformLoc(program, U_SPECEXP);
+    if (loc >= 0) {
+        glUniform1fv(loc, n, exps);
+        ++renderStats.uniforms;
+    }
+
+    // textured objects take their colors from the texture, each
+    // from its own layer
+    if (texRefs[objs[0]].unit >= 0) {
+        GLint layers[MAX_INSTANCES];
+        for (int i = 0; i < n; ++i) {
+            layers[i] = texRefs[objs[i]].layer;
+        }
+        loc = uniformLoc(program, U_LAYER);
         if (loc >= 0) {
-            glUniform4fv(loc, 1, glm::value_ptr(specular));
+            glUniform1iv(loc, n, layers);
+            ++renderStats.uniforms;
         }
+        return;
+    }
 
-        // ambient and diffuse vary from one object to another
-        GLint dloc = getUniformLoc(program, "diffuseColor");
-        GLint aloc = getUniformLoc(program, "ambientColor");
-        //phong shading for spheres , prism, teapot and fork
-        switch (obj) {
-        case Sphere:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(sph_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(sph_diffuse));
-            }
-            break;
-        case Sphere2:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(sph_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(sph_diffuse));
-            }
-            break;
-        case Sphere3:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(sph_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(sph_diffuse));
-            }
-            break;
-        case Prism:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(prism_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(prism_diffuse));
-            }
-            break;
-        case Prism2:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(prism2_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(prism2_diffuse));
-            }
-            break;
-        case Teapot:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(teapot_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(teapot_diffuse));
-            }
-            break;
-        case Fork:
-            if (aloc >= 0) {
-                glUniform4fv(aloc, 1, glm::value_ptr(fork_ambient));
-            }
-            if (dloc >= 0) {
-                glUniform4fv(dloc, 1, glm::value_ptr(fork_diffuse));
-            }
-            break;
-        }
-        break;
+    // ambient and diffuse vary from one instance to another
+    GLint aloc = uniformLoc(program, U_AMBIENTCOLOR);
+    GLint dloc = uniformLoc(program, U_DIFFUSECOLOR);
+    if (aloc >= 0) {
+        glUniform4fv(aloc, n, glm::value_ptr(ambient[0]));
+        ++renderStats.uniforms;
+    }
+    if (dloc >= 0) {
+        glUniform4fv(dloc, n, glm::value_ptr(diffuse[0]));
+        ++renderStats.uniforms;
+    }
+}
+
+///
+/// This function selects the texture array for a textured object (its
+/// layer is sent by setInstanceMaterials()).
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///                  parameter values are to be sent
+/// @param obj       The object type of the object being drawn
+///
+void setMaterialTexture(GLuint program, Object obj)
+{
+    if (texRefs[obj].unit < 0) {
+        return;
     }
+
+    glUniform1i(uniformLoc(program, U_TEXTURES), texRefs[obj].unit);
+    ++renderStats.uniforms;
+    ++renderStats.textures;
 }
 
+///
+/// This function sends the material properties shared by all the
+/// objects to a shader program.
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///                  parameter values are to be sent
+///
+void setMaterialConstants(GLuint program)
+{
+    GLint loc = uniformLoc(program, U_KCOEFF);
+    if (loc >= 0) {
+        glUniform3fv(loc, 1, glm::value_ptr(k));
+        ++renderStats.uniforms;
+    }
+
+    // only the Phong shader uses a specular color
+    loc = uniformLoc(program, U_SPECULARCOLOR);
+    if (loc >= 0) {
+        glUniform4fv(loc, 1, glm::value_ptr(specular));
+        ++renderStats.uniforms;
+    }
+
+    // and only the texture shaders use the back face texture
+    loc = uniformLoc(program, U_BACKTEXTURE);
+    if (loc >= 0 && backRef.unit >= 0) {
+        glUniform1i(loc, backRef.unit);
+        glUniform1i(uniformLoc(program, U_BACKLAYER), backRef.layer);
+        renderStats.uniforms += 2;
+    }
+}
+
+///
+/// This function retrieves the appearance parameters for an object.
+///
+/// @param obj       The object type
+/// @param ambient   Filled in with its ambient color
+/// @param diffuse   Filled in with its diffuse color
+/// @param exp       Filled in with its specular exponent
+///
+/// @return the texture unit of the array holding its texture, or -1
+///         if it isn't texture mapped
+///
+GLint getMaterial(Object obj, glm::vec4 &ambient, glm::vec4 &diffuse,
+                  GLfloat &exp)
+{
+    ambient = *ambientColors[obj];
+    diffuse = *diffuseColors[obj];
+    exp = specExp[obj];
+
+    return texRefs[obj].unit;
+}
+
+///
+/// This function retrieves the layer holding an object's texture.
+///
+/// @param obj   The object type
+///
+/// @return its layer in the texture array (0 if it isn't texture
+///         mapped)
+///
+GLint getTextureLayer(Object obj)
+{
+    return texRefs[obj].layer;
+}
@@ -22,7 +22,23 @@
 
 #include <iostream>
 
+#include <glm/vec4.hpp>
+
 #include "Models.h"
+#include "Textures.h"
+
+///
+/// Register the objects' textures, and start decoding their images on
+/// background threads
+///
+/// Call this as early as possible, and before getMaterial(); the images
+/// are decoded while the rest of the initialization proceeds, and
+/// initTextures() waits for them.
+///
+/// @param compress   use BC1-compressed (and cached) textures if we can?
+/// @param sampler    how the textures are to be sampled
+///
+void startTextureLoads( bool compress, const Sampler &sampler );
 
 ///
 /// This function initializes all texture-related data structures for
@@ -44,4 +60,60 @@ void initTextures( void );
 ///
 void setMaterials( GLuint program, Object obj, bool usingTextures );
 
+///
+/// This function sets up the per-instance appearance parameters for a
+/// group of objects drawn with one instanced draw.  The material
+/// constants and the texture are sent separately (see
+/// setMaterialConstants() and setMaterialTexture()).
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///                  parameter values are to be sent
+/// @param objs      The objects, in instance order
+/// @param n         How many there are (at most MAX_INSTANCES)
+///
+void setInstanceMaterials( GLuint program, const Object *objs, int n );
+
+///
+/// This function selects the texture array for a textured object (its
+/// layer is sent by setInstanceMaterials()).
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///                  parameter values are to be sent
+/// @param obj       The object type of the object being drawn
+///
+void setMaterialTexture( GLuint program, Object obj );
+
+///
+/// This function sends the material properties shared by all the
+/// objects to a shader program.
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///                  parameter values are to be sent
+///
+void setMaterialConstants( GLuint program );
+
+///
+/// This function retrieves the appearance parameters for an object.
+///
+/// @param obj       The object type
+/// @param ambient   Filled in with its ambient color
+/// @param diffuse   Filled in with its diffuse color
+/// @param exp       Filled in with its specular exponent
+///
+/// @return the texture unit of the array holding its texture, or -1
+///         if it isn't texture mapped
+///
+GLint getMaterial( Object obj, glm::vec4 &ambient, glm::vec4 &diffuse,
+                   GLfloat &exp );
+
+///
+/// This function retrieves the layer holding an object's texture.
+///
+/// @param obj   The object type
+///
+/// @return its layer in the texture array (0 if it isn't texture
+///         mapped)
+///
+GLint getTextureLayer( Object obj );
+
 #endif 
@@ -23,6 +23,7 @@
 
 #include "Models.h"
 #include <algorithm>
+#include <vector>
 
 
 // data for the three objects
@@ -40,19 +41,56 @@ using namespace std;
 // PRIVATE GLOBALS
 //
 
+// scratch arrays used to build each shape before it is handed to the
+// Canvas in bulk; these keep their storage from one shape to the next
+static vector<Vertex> sVerts;
+static vector<Normal> sNorms;
+static vector<TexCoord> sUV;
+
 //
 // PUBLIC GLOBALS
 //
 
 // object names (must match the sequence in Models.h)
 const char *objects[ N_OBJECTS ] = {
-     "Cylinder", "Discs", "Sphere","Sphere2","Sphere3","Cube","Cube2","Cube3","SemiSphere","Prism","Prism2","Plate","Bread1","Bread1a","Bread2","Bread2a","Bread3","Bread3a","Teapot","Cylinder2","Fork","Cylinder3"
+    "Cylinder", "Discs", "Sphere", "Sphere2", "Sphere3", "Cube", "Cube2",
+    "Cube3", "SemiSphere", "Prism", "Prism2", "Plate", "Plateside",
+    "Bread1", "Bread2", "Bread3", "Teapot", "Cylinder2", "Bread1a",
+    "Bread2a", "Bread3a", "Fork", "Cylinder3", "Cylinder4"
 };
 
 //
 // PRIVATE FUNCTIONS
 //
 
+///
+/// startShape() - size the scratch arrays for a shape
+///
+/// @param n   number of vertices in the shape
+///
+static void startShape( int n )
+{
+    sVerts.resize( n );
+    sNorms.resize( n );
+    sUV.resize( n );
+}
+
+///
+/// addShape() - add the first n scratch vertices to the Canvas
+///
+/// @param C       which Canvas object to use
+/// @param n       number of vertices to add
+/// @param withUV  include the texture coordinates?
+///
+static void addShape( Canvas &C, int n, bool withUV )
+{
+    C.reserve( n, true, withUV );
+    C.addVertices( sVerts.data(), n );
+    C.addNormals( sNorms.data(), n );
+    if( withUV ) {
+        C.addTexCoords( sUV.data(), n );
+    }
+}
 
 
 
@@ -83,40 +121,26 @@ TexCoord wrapDisc(Vertex vertex) {
 void makeCylinder( Canvas &C )
 {
     // Only use the vertices for the body itself
-    for( int i = body.first; i <= body.last - 2; i += 3 ) {
-
-        // Calculate the base indices of the three vertices
-        int point1 = cylinderElements[i];
-        int point2 = cylinderElements[i + 1];
-        int point3 = cylinderElements[i + 2];
+    int n = (body.last - body.first + 1) / 3 * 3;
 
-        Vertex p1 = cylinderVertices[point1];
-        Vertex p2 = cylinderVertices[point2];
-        Vertex p3 = cylinderVertices[point3];
+    startShape( n );
 
+    for( int i = 0; i < n; ++i ) {
 
-        // Calculate the normal vectors for each vertex
-        Normal n1, n2, n3;
+        Vertex p = cylinderVertices[cylinderElements[body.first + i]];
 
         // Normals on the body run from the axis to the vertex, and
         // are in the XZ plane; thus, for a vertex at (Px,Py,Pz), the
         // corresponding point on the axis is (0,Py,0), and the normal is
         // P - Axis, or just (Px,0,Pz).
 
-        n1 = { p1.x, 0.0f, p1.z };
-        n2 = { p2.x, 0.0f, p2.z };
-        n3 = { p3.x, 0.0f, p3.z };
-
-        // Add this triangle to the collection
-        C.addTriangleWithNorms( p1, n1, p2, n2, p3, n3 );
-        
-        // You will need to add code here to determine texture
-        // coordinates for each vertex, and will need to call the
-        // addTextureCoords() function to add those coordinates
-        // to the Canvas.
-        C.addTextureCoords(wrapSide(p1), wrapSide(p2), wrapSide(p3));
-
+        sVerts[i] = p;
+        sNorms[i] = { p.x, 0.0f, p.z };
+        sUV[i] = wrapSide( p );
     }
+
+    // Add the triangles to the collection
+    addShape( C, n, true );
 }
 
 ///
@@ -146,29 +170,24 @@ static void makeDiscs( Canvas &C )
         }
 
         // Create the triangles
-        for( int i = first; i <= last - 2; i += 3 ) {
-
-            // Calculate the base indices of the three vertices
-            int point1 = cylinderElements[i];
-            int point2 = cylinderElements[i + 1];
-            int point3 = cylinderElements[i + 2];
-
-            Vertex p1 = cylinderVertices[point1];
-            Vertex p2 = cylinderVertices[point2];
-            Vertex p3 = cylinderVertices[point3];
-
-            // Add this triangle to the collection
-            C.addTriangleWithNorms( p1, nn, p2, nn, p3, nn );
-
-            // You will need to add code here to determine texture
-            // coordinates for each vertex, and will need to call the
-            // addTextureCoords() function to add those coordinates
-            // to the Canvas.  Use planar mapping; remember that Y
-            // is constant for all the disc vertices, and remember that
-            // the disc coordinates range from -0.5 to 0.5 in X and Z,
-            // but texture coordinates need to range from 0.0 to 1.0.
-            C.addTextureCoords(wrapDisc(p1), wrapDisc(p2), wrapDisc(p3));
+        int n = (last - first + 1) / 3 * 3;
+
+        startShape( n );
+
+        for( int i = 0; i < n; ++i ) {
+
+            Vertex p = cylinderVertices[cylinderElements[first + i]];
+
+            // Use planar mapping; Y is constant for all the disc
+            // vertices, and the disc coordinates range from -0.5 to
+            // 0.5 in X and Z, but texture coordinates need to range
+            // from 0.0 to 1.0.
+            sVerts[i] = p;
+            sNorms[i] = nn;
+            sUV[i] = wrapDisc( p );
         }
+
+        addShape( C, n, true );
     }
 }
 ///
@@ -194,36 +213,22 @@ TexCoord convertSphere(Vertex vertex) {
 ///
 void makeSphere(Canvas& C)
 {
-    for (int i = 0; i < sphereElementsLength - 2; i += 3) {
+    int n = sphereElementsLength / 3 * 3;
 
-        // Calculate the base indices of the three vertices
-        int point1 = sphereElements[i];
-        int point2 = sphereElements[i + 1];
-        int point3 = sphereElements[i + 2];
-
-        Vertex p1 = sphereVertices[point1];
-        Vertex p2 = sphereVertices[point2];
-        Vertex p3 = sphereVertices[point3];
-
-        // Calculate the surface normals
-        
-        Normal n1 = { sphereVertices[point1].x,
-                      sphereVertices[point1].y,
-                      sphereVertices[point1].z };
-
-        Normal n2 = { sphereVertices[point2].x,
-                      sphereVertices[point2].y,
-                      sphereVertices[point2].z };
-
-        Normal n3 = { sphereVertices[point3].x,
-                      sphereVertices[point3].y,
-                      sphereVertices[point3].z };
-
-        // Add triangle and vertex normals
-        C.addTriangleWithNorms(p1, n1, p2, n2, p3, n3);
-        C.addTextureCoords(convertSphere(p1), convertSphere(p2), convertSphere(p3));
-  
+    startShape( n );
+
+    for (int i = 0; i < n; ++i) {
+
+        Vertex p = sphereVertices[sphereElements[i]];
+
+        // The surface normal is the vertex position itself
+        sVerts[i] = p;
+        sNorms[i] = { p.x, p.y, p.z };
+        sUV[i] = convertSphere(p);
     }
+
+    // Add triangles, vertex normals, and texture coordinates
+    addShape(C, n, true);
 }
 // vertex coordinate of a cube to texture coordinates
 
@@ -267,6 +272,8 @@ TexCoord convertCube(const Vertex& vertex)
 ///
 void makeCube(Canvas& C)
 {
+    C.reserve(cubeElementsLength);
+
     for (int face = 0; face < 6; ++face) {
 
         // Select the starting and ending indices
@@ -311,26 +318,23 @@ void makeCube(Canvas& C)
         }
 
         // Create the triangles
-        for (int i = start; i <= end - 2; i += 3) {
+        int n = (end - start + 1) / 3 * 3;
 
-            // Calculate the base indices of the three vertices
-            int point1 = cubeElements[i];
-            int point2 = cubeElements[i + 1];
-            int point3 = cubeElements[i + 2];
+        startShape(n);
 
-            Vertex p1 = cubeVertices[point1];
-            Vertex p2 = cubeVertices[point2];
-            Vertex p3 = cubeVertices[point3];
+        for (int i = 0; i < n; ++i) {
+            Vertex p = cubeVertices[cubeElements[start + i]];
 
-            // Add this triangle to the collection
-            C.addTriangleWithNorms(p1, nn, p2, nn, p3, nn);
-            // Add texture coordinates for the triangle
-            C.addTextureCoords(convertCube(p1), convertCube(p2), convertCube(p3));
+            sVerts[i] = p;
+            sNorms[i] = nn;
+            sUV[i] = convertCube(p);
         }
+
+        // Add the triangles and their texture coordinates
+        addShape(C, n, true);
     }
 }
 
-
 TexCoord convertSemiSphereUV(Vertex vertex) {
     TexCoord t;
     float Pi =  3.141592654 ;
@@ -350,38 +354,31 @@ TexCoord convertSemiSphereUV(Vertex vertex) {
 ///
 void makeSemiSphere(Canvas& C)
 {
-    for (int i = 0; i < sphereElementsLength - 2; i += 3) {
+    int n = 0;
 
-        // Calculate the base indices of the three vertices
-        int point1 = sphereElements[i];
-        int point2 = sphereElements[i + 1];
-        int point3 = sphereElements[i + 2];
+    startShape(sphereElementsLength);
 
-        Vertex p1 = sphereVertices[point1];
-        Vertex p2 = sphereVertices[point2];
-        Vertex p3 = sphereVertices[point3];
+    for (int i = 0; i < sphereElementsLength - 2; i += 3) {
+
+        Vertex p1 = sphereVertices[sphereElements[i]];
+        Vertex p2 = sphereVertices[sphereElements[i + 1]];
+        Vertex p3 = sphereVertices[sphereElements[i + 2]];
 
         //  vertices' y coordinates are less than or equal to 0
         if (p1.y <= 0.0f && p2.y <= 0.0f && p3.y <= 0.0f) {
 
-            // Calculate the surface normals
-            Normal n1 = { sphereVertices[point1].x,
-                          sphereVertices[point1].y,
-                          sphereVertices[point1].z };
-
-            Normal n2 = { sphereVertices[point2].x,
-                          sphereVertices[point2].y,
-                          sphereVertices[point2].z };
-
-            Normal n3 = { sphereVertices[point3].x,
-                          sphereVertices[point3].y,
-                          sphereVertices[point3].z };
-
-            // Add triangle and vertex normals
-            C.addTriangleWithNorms(p1, n1, p2, n2, p3, n3);
-            C.addTextureCoords(convertSemiSphereUV(p1), convertSemiSphereUV(p2), convertSemiSphereUV(p3));
+            // The surface normals are the vertex positions
+            Vertex p[] = { p1, p2, p3 };
+            for (int k = 0; k < 3; ++k, ++n) {
+                sVerts[n] = p[k];
+                sNorms[n] = { p[k].x, p[k].y, p[k].z };
+                sUV[n] = convertSemiSphereUV(p[k]);
+            }
         }
     }
+
+    // Add triangles, vertex normals, and texture coordinates
+    addShape(C, n, true);
 }
 ///
 /// createPrism - internal function to create a Prism from its vertex list
@@ -424,17 +421,23 @@ void makePrism(Canvas& C)
 ///
  void makeTeapot(Canvas& C)
 {
-    for (int i = 0; i < teapotElementsLength - 2; i += 3) {
-        C.addTriangleWithNorms(
-            teapotVertices[teapotElements[i]], teapotNormals[teapotNormalIndices[i]],
-            teapotVertices[teapotElements[i + 1]], teapotNormals[teapotNormalIndices[i + 1]],
-            teapotVertices[teapotElements[i + 2]], teapotNormals[teapotNormalIndices[i + 2]]
-        );
+    int n = teapotElementsLength / 3 * 3;
+
+    startShape(n);
 
+    for (int i = 0; i < n; ++i) {
+        sVerts[i] = teapotVertices[teapotElements[i]];
+        sNorms[i] = teapotNormals[teapotNormalIndices[i]];
     }
+
+    addShape(C, n, false);
 }
  void makeLeftTeapot(Canvas& C)
  {
+     int n = 0;
+
+     startShape(teapotElementsLength);
+
      for (int i = 0; i < teapotElementsLength - 2; i += 3) {
          Vertex v1 = teapotVertices[teapotElements[i]];
          Vertex v2 = teapotVertices[teapotElements[i + 1]];
@@ -446,12 +449,13 @@ void makePrism(Canvas& C)
          }
 
          // Add the triangle with normals
-         C.addTriangleWithNorms(
-             v1, teapotNormals[teapotNormalIndices[i]],
-             v2, teapotNormals[teapotNormalIndices[i + 1]],
-             v3, teapotNormals[teapotNormalIndices[i + 2]]
-         );
+         for (int k = 0; k < 3; ++k, ++n) {
+             sVerts[n] = teapotVertices[teapotElements[i + k]];
+             sNorms[n] = teapotNormals[teapotNormalIndices[i + k]];
+         }
      }
+
+     addShape(C, n, false);
  }
 
  /// makeFork - internal function to create a fork from its vertex list
@@ -459,62 +463,97 @@ void makePrism(Canvas& C)
 /// @param C        which Canvas object to use
  void makeFork(Canvas& C)
  {
-     for (int i = 0; i < forkElementsLength - 2; i += 3) {
-         C.addTriangleWithNorms(
-             forkVertices[forkElements[i]], forkNormals[forkNormalIndices[i]],
-             forkVertices[forkElements[i + 1]], forkNormals[forkNormalIndices[i + 1]],
-             forkVertices[forkElements[i + 2]], forkNormals[forkNormalIndices[i + 2]]
-         );
+     int n = forkElementsLength / 3 * 3;
+
+     startShape(n);
+
+     for (int i = 0; i < n; ++i) {
+         sVerts[i] = forkVertices[forkElements[i]];
+         sNorms[i] = forkNormals[forkNormalIndices[i]];
      }
+
+     addShape(C, n, false);
  }
 
 
 
 
+// the function which builds each object (order depends upon the
+// Object type in Models.h); objects built by the same function have
+// identical meshes
+static void (*const builders[N_OBJECTS])( Canvas &C ) = {
+    makeCylinder,    // Cylinder
+    makeDiscs,       // Discs
+    makeSphere,      // Sphere
+    makeSphere,      // Sphere2
+    makeSphere,      // Sphere3
+    makeCube,        // Cube
+    makeCube,        // Cube2
+    makeCube,        // Cube3
+    makeSemiSphere,  // SemiSphere
+    makePrism,       // Prism
+    makePrism,       // Prism2
+    makeCube,        // Plate
+    makeCube,        // Plateside
+    makeCube,        // Bread1
+    makeCube,        // Bread2
+    makeCube,        // Bread3
+    makeTeapot,      // Teapot
+    makeCylinder,    // Cylinder2
+    makeCube,        // Bread1a
+    makeCube,        // Bread2a
+    makeCube,        // Bread3a
+    makeFork,        // Fork
+    makeCylinder,    // Cylinder3
+    makeLeftTeapot   // Cylinder4
+};
+
 //
 // PUBLIC FUNCTIONS
 //
 
 ///
-/// Create an object
+/// Build an object's geometry in a Canvas
 ///
 /// @param C      the Canvas we'll be using
 /// @param obj    which object to draw
-/// @param buf    BufferSet to use for the object
 ///
 
-void createObject(Canvas& C, Object obj, BufferSet& buf)
+void makeObject(Canvas& C, Object obj)
 {
-    // start with a fresh Canvas
+    // start with a fresh Canvas (which keeps its storage)
     C.clear();
 
     // create the specified object
-    switch (obj) {
-    case Cylinder:  makeCylinder(C);  break;
-    case Discs:     makeDiscs(C);     break;
-    case Sphere:    makeSphere(C);    break; 
-    case Sphere2:   makeSphere(C);    break;
-    case Sphere3:   makeSphere(C);    break;
-    case Cube:      makeCube(C);      break;
-    case Cube2:     makeCube(C);      break;
-    case Cube3:     makeCube(C);      break;
-    case SemiSphere:makeSemiSphere(C);break;
-    case Prism:     makePrism(C);     break;
-    case Prism2:    makePrism(C);     break;
-    case Plate:     makeCube(C);      break;
-    case Plateside: makeCube(C);      break;
-    case Bread1:    makeCube(C);      break;
-    case Bread2:    makeCube(C);      break;
-    case Bread3:    makeCube(C);      break;
-    case Bread1a:   makeCube(C);      break;
-    case Bread2a:   makeCube(C);      break;
-    case Bread3a:   makeCube(C);      break;
-    case Teapot:    makeTeapot(C);    break;
-    case Cylinder2: makeCylinder(C);  break;
-    case Fork:      makeFork(C);      break;
-    case Cylinder3: makeCylinder(C);  break;
-    case Cylinder4: makeLeftTeapot(C);  break;
+    builders[obj](C);
+}
+
+///
+/// Find the first object with the same mesh as another
+///
+/// @param obj    the object
+///
+/// @return the first object (in Object order) built like 'obj'
+///
+Object meshObject(Object obj)
+{
+    int i = 0;
+    while (builders[i] != builders[obj]) {
+        ++i;
     }
+    return (Object) i;
+}
+
+///
+/// Create an object
+///
+/// @param C      the Canvas we'll be using
+/// @param obj    which object to draw
+/// @param buf    BufferSet to use for the object
+///
+void createObject(Canvas& C, Object obj, BufferSet& buf)
+{
+    makeObject(C, obj);
 
     // create the buffers for the object
     buf.createBuffers(C);
@@ -26,6 +26,10 @@ typedef
         , N_OBJECTS
     } Object;
 
+// most objects drawn by a single instanced draw (must match the
+// array sizes in the shaders)
+#define MAX_INSTANCES   8
+
 //
 // PUBLIC GLOBALS
 //
@@ -37,6 +41,23 @@ extern const char *objects[ N_OBJECTS ];
 // PUBLIC FUNCTIONS
 //
 
+///
+/// Build an object's geometry in a Canvas (without creating buffers)
+///
+/// @param C      the Canvas we'll be using
+/// @param obj    which object to draw
+///
+void makeObject( Canvas &C, Object obj );
+
+///
+/// Find the first object with the same mesh as another
+///
+/// @param obj    the object
+///
+/// @return the first object (in Object order) built like 'obj'
+///
+Object meshObject( Object obj );
+
 ///
 /// Create an object
 ///
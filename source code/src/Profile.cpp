@@ -0,0 +1,316 @@
+//
+//  Profile.cpp
+//
+//  CPU and GPU profiling, with export in Chrome trace format.
+//
+
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Profile.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// number of frames of GPU queries in flight; results are read back
+// this many frames after they were issued
+#define PROFILE_FRAMES  4
+
+// most events kept (later ones are counted, but dropped)
+#define MAX_EVENTS      (1 << 20)
+
+// trace thread IDs
+#define TID_CPU     1
+#define TID_GPU     2
+
+// a completed scope (times in microseconds)
+typedef struct event_s {
+    const char *name;
+    double start;
+    double duration;
+    int tid;
+} Event;
+
+// a GPU scope awaiting its query results
+typedef struct gpuscope_s {
+    const char *name;
+    GLuint begin, end;      // timestamp queries
+} GpuScope;
+
+// GPU scopes issued during one frame
+typedef struct gpuframe_s {
+    vector<GpuScope> scopes;
+    GLuint last;            // the query issued last (scopes nest, so
+                            // this is the end of an outer scope)
+    vector<GLuint> spare;   // queries free for reuse
+} GpuFrame;
+
+static bool enabled = false;
+static bool gpuTiming = false;
+static const char *tracePath;
+
+static vector<Event> events;
+static long dropped = 0;
+
+static GpuFrame gpuFrames[ PROFILE_FRAMES ];
+static int frameNum = 0;
+
+// open GPU scopes (indices into the current frame's scopes)
+static vector<size_t> gpuStack;
+
+// the CPU and GPU clocks at profileInit(), which line the two up
+static double cpuBase;
+static GLint64 gpuBase;
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Record a completed scope
+///
+/// @param name      the scope name
+/// @param start     start time (microseconds)
+/// @param duration  length (microseconds)
+/// @param tid       trace thread ID
+///
+static void addEvent( const char *name, double start, double duration,
+                      int tid )
+{
+    if( events.size() >= MAX_EVENTS ) {
+        ++dropped;
+        return;
+    }
+
+    Event e = { name, start, duration, tid };
+    events.push_back( e );
+}
+
+///
+/// Get a timestamp query for the current frame, reusing one if we can
+///
+/// @return the query ID
+///
+static GLuint newQuery( void )
+{
+    GpuFrame &f = gpuFrames[ frameNum % PROFILE_FRAMES ];
+    GLuint q;
+
+    if( f.spare.empty() ) {
+        glGenQueries( 1, &q );
+    } else {
+        q = f.spare.back();
+        f.spare.pop_back();
+    }
+
+    return( q );
+}
+
+///
+/// Collect the results of a frame's GPU scopes
+///
+/// @param f      the frame
+/// @param wait   wait for results which aren't ready yet?
+///
+static void collectFrame( GpuFrame &f, bool wait )
+{
+    if( f.scopes.empty() ) {
+        return;
+    }
+
+    // if the last query issued is done, they all are
+    GLuint avail = GL_TRUE;
+    if( !wait ) {
+        glGetQueryObjectuiv( f.last, GL_QUERY_RESULT_AVAILABLE, &avail );
+    }
+
+    for( size_t i = 0; i < f.scopes.size(); ++i ) {
+        GpuScope &s = f.scopes[i];
+
+        if( avail ) {
+            GLuint64 t0, t1;
+            glGetQueryObjectui64v( s.begin, GL_QUERY_RESULT, &t0 );
+            glGetQueryObjectui64v( s.end, GL_QUERY_RESULT, &t1 );
+            addEvent( s.name, cpuBase + (double) (t0 - gpuBase) / 1000.0,
+                      (double) (t1 - t0) / 1000.0, TID_GPU );
+        }
+
+        f.spare.push_back( s.begin );
+        f.spare.push_back( s.end );
+    }
+
+    // rather than stall, results which are still pending are discarded
+    if( !avail ) {
+        dropped += f.scopes.size();
+    }
+
+    f.scopes.clear();
+}
+
+///
+/// Current time on the CPU clock
+///
+/// @return the time, in microseconds
+///
+static double now( void )
+{
+    return( glfwGetTime() * 1.0e6 );
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Constructor
+///
+/// @param name   what is being timed
+/// @param gpu    also time the GL commands issued within the scope?
+///
+ProfileScope::ProfileScope( const char *name, bool gpu ) :
+    name(name), start(0.0), gpu(false)
+{
+    if( !enabled ) {
+        return;
+    }
+
+    start = now();
+
+    if( gpu && gpuTiming ) {
+        GpuFrame &f = gpuFrames[ frameNum % PROFILE_FRAMES ];
+        GpuScope s = { name, newQuery(), 0 };
+
+        glQueryCounter( s.begin, GL_TIMESTAMP );
+        gpuStack.push_back( f.scopes.size() );
+        f.scopes.push_back( s );
+        this->gpu = true;
+    }
+}
+
+///
+/// Destructor
+///
+ProfileScope::~ProfileScope( void )
+{
+    if( !enabled ) {
+        return;
+    }
+
+    if( gpu ) {
+        GpuFrame &f = gpuFrames[ frameNum % PROFILE_FRAMES ];
+        GpuScope &s = f.scopes[ gpuStack.back() ];
+
+        s.end = newQuery();
+        glQueryCounter( s.end, GL_TIMESTAMP );
+        f.last = s.end;
+        gpuStack.pop_back();
+    }
+
+    addEvent( name, start, now() - start, TID_CPU );
+}
+
+///
+/// Turn profiling on
+///
+/// GPU timing needs OpenGL 3.3 or ARB_timer_query; without them, only
+/// CPU scopes are recorded.
+///
+/// @param path   where profileFinish() is to write the trace
+///
+void profileInit( const char *path )
+{
+    tracePath = path;
+    enabled = true;
+    events.reserve( 65536 );
+
+    gpuTiming = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    if( gpuTiming ) {
+        glGetInteger64v( GL_TIMESTAMP, &gpuBase );
+    } else {
+        cerr << "GPU timer queries not supported, profiling CPU only"
+             << endl;
+    }
+    cpuBase = now();
+}
+
+///
+/// Is profiling on?
+///
+/// @return true if profileInit() has been called
+///
+bool profiling( void )
+{
+    return( enabled );
+}
+
+///
+/// Mark the end of a frame
+///
+/// Call this once per frame, after the frame's commands have been
+/// issued; it collects the GPU timings from a frame long enough ago
+/// that they should be ready.
+///
+void profileFrame( void )
+{
+    if( !gpuTiming ) {
+        return;
+    }
+
+    // the oldest frame is the one whose slot is about to be reused
+    ++frameNum;
+    collectFrame( gpuFrames[ frameNum % PROFILE_FRAMES ], false );
+}
+
+///
+/// Collect any outstanding GPU timings and write the trace file
+///
+void profileFinish( void )
+{
+    if( !enabled ) {
+        return;
+    }
+
+    if( gpuTiming ) {
+        for( int i = 1; i <= PROFILE_FRAMES; ++i ) {
+            collectFrame( gpuFrames[ (frameNum + i) % PROFILE_FRAMES ], true );
+        }
+    }
+
+    FILE *fp = fopen( tracePath, "w" );
+    if( fp == NULL ) {
+        perror( tracePath );
+        return;
+    }
+
+    fputs( "{\"traceEvents\":[\n", fp );
+    fprintf( fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+             "\"tid\":%d,\"args\":{\"name\":\"CPU\"}},\n", TID_CPU );
+    fprintf( fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+             "\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", TID_GPU );
+    for( size_t i = 0; i < events.size(); ++i ) {
+        const Event &e = events[i];
+        fprintf( fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+                 "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                 e.name, e.tid, e.start - cpuBase, e.duration );
+    }
+    fputs( "\n]}\n", fp );
+    fclose( fp );
+
+    cerr << "Profile: " << events.size() << " events written to "
+         << tracePath;
+    if( dropped > 0 ) {
+        cerr << " (" << dropped << " dropped)";
+    }
+    cerr << endl;
+}
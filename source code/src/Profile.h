@@ -0,0 +1,101 @@
+//
+//  Profile.h
+//
+//  CPU and GPU profiling, with export in Chrome trace format.
+//
+//  Profiling is off unless profileInit() is called (see --profile in
+//  Application.cpp); until then, scopes cost a single test.
+//
+//  CPU time is measured with nested scopes:
+//
+//      {
+//          PROFILE_SCOPE( "display" );
+//          ...
+//      }
+//
+//  A GPU_SCOPE additionally brackets the GL commands issued within it
+//  with GL_TIMESTAMP queries.  The query results are read back several
+//  frames later (see profileFrame()), so collecting them never stalls
+//  the pipeline.  Scope names must be string constants.
+//
+//  The trace file can be loaded into chrome://tracing or Perfetto.
+//
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+///
+/// A timed region of code, from construction to destruction
+///
+class ProfileScope {
+
+    const char *name;
+    double start;
+    bool gpu;
+
+public:
+    ///
+    /// Constructor
+    ///
+    /// @param name   what is being timed
+    /// @param gpu    also time the GL commands issued within the scope?
+    ///
+    ProfileScope( const char *name, bool gpu = false );
+
+    ///
+    /// Destructor
+    ///
+    ~ProfileScope( void );
+
+};
+
+#define PROFILE_CAT2(a,b)   a##b
+#define PROFILE_CAT(a,b)    PROFILE_CAT2(a,b)
+
+// time the rest of the enclosing block
+#define PROFILE_SCOPE(name) \
+    ProfileScope PROFILE_CAT(profScope_,__LINE__)( name )
+
+// time the rest of the enclosing block on both the CPU and the GPU
+#define GPU_SCOPE(name) \
+    ProfileScope PROFILE_CAT(profScope_,__LINE__)( name, true )
+
+///
+/// Turn profiling on
+///
+/// GPU timing needs OpenGL 3.3 or ARB_timer_query; without them, only
+/// CPU scopes are recorded.
+///
+/// @param path   where profileFinish() is to write the trace
+///
+void profileInit( const char *path );
+
+///
+/// Is profiling on?
+///
+/// @return true if profileInit() has been called
+///
+bool profiling( void );
+
+///
+/// Mark the end of a frame
+///
+/// Call this once per frame, after the frame's commands have been
+/// issued; it collects the GPU timings from a frame long enough ago
+/// that they should be ready.
+///
+void profileFrame( void );
+
+///
+/// Collect any outstanding GPU timings and write the trace file
+///
+void profileFinish( void );
+
+#endif
@@ -0,0 +1,180 @@
+//
+//  Scene.cpp
+//
+//  Placement of the objects in the scene.
+//
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "Scene.h"
+#include "Viewing.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// which rotation angles are replaced by the object's animation angle
+#define SPIN_X      1
+#define SPIN_Y      2
+#define SPIN_Z      4
+#define SPIN_XZ     (SPIN_X | SPIN_Z)
+#define SPIN_ALL    (SPIN_X | SPIN_Y | SPIN_Z)
+
+// how an object is placed in the scene
+typedef struct placement_s {
+    glm::vec3 scale;    // scale factors
+    glm::vec3 rotate;   // rotation angles (degrees)
+    int spin;           // which of those follow the animation angle
+    glm::vec3 xlate;    // translation
+} Placement;
+
+// object placements (must match the sequence of the Object enum)
+static const Placement placements[ N_OBJECTS ] = {
+    // Cylinder
+    { { 0.45f, 0.5f, 0.65f },   { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { 1.5f, 0.5f, 0.3f } },
+    // Discs
+    { { 0.45f, 0.5f, 0.65f },   { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { 1.5f, 0.5f, 0.3f } },
+    // Sphere
+    { { 0.6f, 0.3f, 0.3f },     { 0.0f, 30.0f, 0.0f },    SPIN_XZ,
+      { 1.2f, 1.4f, -1.6f } },
+    // Sphere2
+    { { 0.7f, 0.5f, 0.5f },     { 0.0f, 45.0f, 0.0f },    SPIN_XZ,
+      { 0.86f, 1.5f, -2.2f } },
+    // Sphere3
+    { { 0.7f, 0.5f, 0.5f },     { 0.0f, 30.0f, 0.0f },    SPIN_XZ,
+      { 1.6f, 1.62f, -1.65f } },
+    // Cube
+    { { 10.0f, 10.0f, 1.0f },   { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { -1.25f, 1.5f, -4.5f } },
+    // Cube2
+    { { 10.0f, 3.0f, 15.0f },   { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { -1.25f, -1.5f, -3.5f } },
+    // Cube3
+    { { 4.0f, 0.75f, 3.0f },    { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { 0.0f, 0.5f, -2.5f } },
+    // SemiSphere
+    { { 1.5f, 1.5f, 1.5f },     { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { 1.25f, 1.6f, -2.0f } },
+    // Prism
+    { { 2.5f, 1.25f, 1.0f },    { 0.0f, 80.0f, 0.0f },    SPIN_XZ,
+      { -1.6f, -1.2f, 2.0f } },
+    // Prism2
+    { { 2.5f, 0.07f, 1.0f },    { 0.0f, 80.0f, 0.0f },    SPIN_XZ,
+      { -1.6f, 0.1f, 2.0f } },
+    // Plate
+    { { 1.51f, 0.19f, 2.51f },  { 0.0f, 220.0f, 0.0f },   SPIN_XZ,
+      { 0.45f, 0.02f, 0.5f } },
+    // Plateside
+    { { 1.5f, 0.2f, 2.5f },     { 0.0f, 220.0f, 0.0f },   SPIN_XZ,
+      { 0.45f, 0.02f, 0.5f } },
+    // Bread1
+    { { 0.81f, 0.159f, 0.51f }, { 0.0f, 220.0f, 0.0f },   SPIN_XZ,
+      { -0.1f, 0.25f, 0.2f } },
+    // Bread2
+    { { 0.81f, 0.159f, 0.51f }, { 0.0f, 220.0f, 0.0f },   SPIN_XZ,
+      { -0.05f, 0.45f, 0.2f } },
+    // Bread3
+    { { 1.0f, 0.159f, 0.7f },   { 0.0f, 100.0f, 0.0f },   SPIN_XZ,
+      { 0.7f, 0.25f, 1.0f } },
+    // Teapot
+    { { 2.1f, 2.8f, 2.1f },     { 0.0f, 30.0f, 0.0f },    SPIN_XZ,
+      { -0.8f, 0.9f, -2.0f } },
+    // Cylinder2
+    { { 0.45f, 0.65f, 0.65f },  { 0.0f, 0.0f, 0.0f },     SPIN_ALL,
+      { 1.5f, 0.5f, 0.3f } },
+    // Bread1a
+    { { 0.8f, 0.16f, 0.5f },    { 0.0f, 220.0f, 0.0f },   SPIN_XZ,
+      { -0.1f, 0.25f, 0.2f } },
+    // Bread2a
+    { { 0.8f, 0.16f, 0.5f },    { 0.0f, 220.0f, 0.0f },   SPIN_XZ,
+      { -0.05f, 0.45f, 0.2f } },
+    // Bread3a
+    { { 0.99f, 0.16f, 0.69f },  { 0.0f, 100.0f, 0.0f },   SPIN_XZ,
+      { 0.7f, 0.25f, 1.0f } },
+    // Fork
+    { { 0.08f, 0.08f, 0.01f },  { 280.0f, 0.0f, 110.0f }, SPIN_Y,
+      { -1.1f, 0.3f, 1.2f } },
+    // Cylinder3
+    { { 1.0f, 0.15f, 1.0f },    { 270.0f, 0.0f, 60.0f },  0,
+      { 1.2f, 1.7f, -1.7f } },
+    // Cylinder4
+    { { 1.1f, 1.0f, 0.8f },     { 0.0f, 160.0f, 0.0f },   0,
+      { 1.4f, 0.28f, 0.3f } }
+};
+
+// animation angles, and the model matrices they produce
+static float angles[ N_OBJECTS ];
+static glm::mat4 matrices[ N_OBJECTS ];
+
+// which matrices are up to date (none of them, to begin with)
+static bool current[ N_OBJECTS ];
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Retrieve an object's animation angle
+///
+/// @param obj    the object
+///
+/// @return its current angle, in degrees
+///
+float objectAngle( Object obj )
+{
+    return( angles[obj] );
+}
+
+///
+/// Change an object's animation angle
+///
+/// @param obj    the object
+/// @param angle  its new angle, in degrees
+///
+void setObjectAngle( Object obj, float angle )
+{
+    if( angle != angles[obj] ) {
+        angles[obj] = angle;
+
+        // objects with no animated rotation never change
+        if( placements[obj].spin != 0 ) {
+            current[obj] = false;
+        }
+    }
+}
+
+///
+/// Retrieve an object's model matrix
+///
+/// @param obj    the object
+///
+/// @return the matrix, recomputed first if the object has moved
+///
+const glm::mat4 &objectMatrix( Object obj )
+{
+    if( !current[obj] ) {
+        const Placement &p = placements[obj];
+        glm::vec3 rotate = p.rotate;
+
+        if( p.spin & SPIN_X ) rotate.x = angles[obj];
+        if( p.spin & SPIN_Y ) rotate.y = angles[obj];
+        if( p.spin & SPIN_Z ) rotate.z = angles[obj];
+
+        matrices[obj] = modelMatrix( p.scale, rotate, p.xlate );
+        current[obj] = true;
+    }
+
+    return( matrices[obj] );
+}
@@ -0,0 +1,52 @@
+//
+//  Scene.h
+//
+//  Placement of the objects in the scene.
+//
+//  Each object's scale, rotation, and translation are held in a table,
+//  along with a cached copy of the resulting model matrix.  The matrix
+//  is only recomputed when the object's animation angle changes, so
+//  objects which don't move cost no matrix math from frame to frame.
+//
+
+#ifndef SCENE_H_
+#define SCENE_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/mat4x4.hpp>
+
+#include "Models.h"
+
+///
+/// Retrieve an object's animation angle
+///
+/// @param obj    the object
+///
+/// @return its current angle, in degrees
+///
+float objectAngle( Object obj );
+
+///
+/// Change an object's animation angle
+///
+/// @param obj    the object
+/// @param angle  its new angle, in degrees
+///
+void setObjectAngle( Object obj, float angle );
+
+///
+/// Retrieve an object's model matrix
+///
+/// @param obj    the object
+///
+/// @return the matrix, recomputed first if the object has moved
+///
+const glm::mat4 &objectMatrix( Object obj );
+
+#endif
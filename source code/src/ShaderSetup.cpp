@@ -37,18 +37,129 @@
 //         creates a shader program object, attaches all the shader
 //         objects to it, and links the result.
 //
+//     uniformLoc(prog,which)
+//     attribLoc(prog,which)
+//         These functions return the locations of the standard uniform
+//         variables and vertex attributes in a program created by
+//         shaderLink(), from a table built when the program was linked.
+//
 
 #include <iostream>
 #include <cstdlib>
 #include <cstring>
 // we use stdio for sprintf()
 #include <cstdio>
+#include <vector>
 
 #include "ShaderSetup.h"
 #include "Utils.h"
 
 using namespace std;
 
+// names of the attribute variables (must match the sequence in the header)
+const char *attribNames[ N_ATTRIBS ] = {
+    "vPosition", "vColor", "vNormal", "vTexCoord"
+};
+
+// names of the uniform blocks (must match the sequence in the header)
+const char *blockNames[ N_BLOCKS ] = {
+    "Frame", "Objects"
+};
+
+// names of the uniform variables (must match the sequence in the header)
+const char *uniformNames[ N_UNIFORMS ] = {
+    "viewMat", "projMat", "modelMat",
+    "modelViewMat", "mvpMat", "normalMat",
+    "lightPosition", "lightColor", "ambientLight",
+    "ambientColor", "diffuseColor", "specularColor", "specExp", "kCoeff",
+    "textures", "layer", "objectBase", "backTexture", "backLayer"
+};
+
+//
+// Location tables, indexed by program ID
+//
+typedef struct locations_s {
+    GLint uniforms[ N_UNIFORMS ];
+    GLint attribs[ N_ATTRIBS ];
+} Locations;
+
+static vector<Locations> locTable;
+
+///
+/// findName(name,names,n)
+///
+/// Look a variable name up in one of the name tables.  The "[0]" which
+/// OpenGL appends to the names of arrays is ignored.
+///
+/// @param name    the name reported by OpenGL
+/// @param names   the table to search
+/// @param n       the number of entries in the table
+/// @return        the index of the name in the table, or -1
+///
+static int findName( const char *name, const char *names[], int n ) {
+    size_t len = strlen( name );
+
+    if( len > 3 && strcmp( name + len - 3, "[0]" ) == 0 ) {
+        len -= 3;
+    }
+
+    for( int i = 0; i < n; ++i ) {
+        if( strlen( names[i] ) == len && strncmp( name, names[i], len ) == 0 ) {
+            return( i );
+        }
+    }
+
+    return( -1 );
+}
+
+///
+/// buildLocations(prog)
+///
+/// Reflect the active uniforms and attributes of a newly-linked program,
+/// and record the locations of the standard ones in its table entry.
+///
+/// @param prog   the shader program
+///
+static void buildLocations( GLuint prog ) {
+    if( prog >= locTable.size() ) {
+        locTable.resize( prog + 1 );
+    }
+
+    Locations &locs = locTable[prog];
+    for( int i = 0; i < N_UNIFORMS; ++i ) {
+        locs.uniforms[i] = -1;
+    }
+    for( int i = 0; i < N_ATTRIBS; ++i ) {
+        locs.attribs[i] = -1;
+    }
+
+    GLchar name[256];
+    GLsizei length;
+    GLint size, count;
+    GLenum type;
+
+    // uniforms in blocks have no location, so they stay at -1
+    glGetProgramiv( prog, GL_ACTIVE_UNIFORMS, &count );
+    for( GLint i = 0; i < count; ++i ) {
+        glGetActiveUniform( prog, i, sizeof(name), &length, &size, &type,
+                            name );
+        int which = findName( name, uniformNames, N_UNIFORMS );
+        if( which >= 0 ) {
+            locs.uniforms[which] = glGetUniformLocation( prog, name );
+        }
+    }
+
+    glGetProgramiv( prog, GL_ACTIVE_ATTRIBUTES, &count );
+    for( GLint i = 0; i < count; ++i ) {
+        glGetActiveAttrib( prog, i, sizeof(name), &length, &size, &type,
+                           name );
+        int which = findName( name, attribNames, N_ATTRIBS );
+        if( which >= 0 ) {
+            locs.attribs[which] = glGetAttribLocation( prog, name );
+        }
+    }
+}
+
 ///
 /// readTextFile(name)
 ///
@@ -347,7 +458,9 @@ GLuint shaderCreate( const GLchar **src, GLenum type, ShaderError *err ) {
 ///
 /// shaderLink( GLuint ids[], size_t num, ShaderError *err )
 ///
-/// Link a collection of shaders into a shader program.
+/// Link a collection of shaders into a shader program.  The standard
+/// vertex attributes are bound to their fixed locations first, and the
+/// standard uniform blocks to their binding points afterward.
 ///
 /// @param ids   array of shader object ids
 /// @param num   number of elements in the array
@@ -376,6 +489,12 @@ GLuint shaderLink( GLuint ids[], size_t num, ShaderError *err ) {
         glAttachShader( prog, ids[i] );
     }
 
+    // Fix the attribute locations; names the shaders don't use
+    // are simply ignored
+    for( int i = 0; i < N_ATTRIBS; ++i ) {
+        glBindAttribLocation( prog, i, attribNames[i] );
+    }
+
     // Report any message log information
     printProgramInfoLog( prog );
 
@@ -389,9 +508,59 @@ GLuint shaderLink( GLuint ids[], size_t num, ShaderError *err ) {
         return( 0 );
     }
 
+    // Connect the uniform blocks (GLSL 1.20 shaders have none)
+    if( GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object ) {
+        for( int i = 0; i < N_BLOCKS; ++i ) {
+            GLuint index = glGetUniformBlockIndex( prog, blockNames[i] );
+            if( index != GL_INVALID_INDEX ) {
+                glUniformBlockBinding( prog, index, i );
+            }
+        }
+    }
+
+    // Record where the standard variables ended up
+    buildLocations( prog );
+
     return( prog );
 }
 
+///
+/// uniformLoc(program,which)
+///
+/// Location of a standard uniform variable in a program linked by
+/// shaderLink().  For arrays, this is the location of the first entry.
+///
+/// @param program   the shader program
+/// @param which     the uniform variable
+/// @return          its location, or -1 if the program doesn't use it
+///                  (or it is part of a uniform block)
+///
+GLint uniformLoc( GLuint program, Uniform which ) {
+    if( program >= locTable.size() ) {
+        return( -1 );
+    }
+
+    return( locTable[program].uniforms[which] );
+}
+
+///
+/// attribLoc(program,which)
+///
+/// Location of a standard vertex attribute in a program linked by
+/// shaderLink().
+///
+/// @param program   the shader program
+/// @param which     the attribute
+/// @return          its location, or -1 if the program doesn't use it
+///
+GLint attribLoc( GLuint program, Attribute which ) {
+    if( program >= locTable.size() ) {
+        return( -1 );
+    }
+
+    return( locTable[program].attribs[which] );
+}
+
 ///
 /// shaderSetupStr(vertex,fragment,geometry,err)
 ///
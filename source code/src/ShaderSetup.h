@@ -35,6 +35,88 @@ typedef enum sError {
     E_PROG_ALLOC, E_PROG_LINK
 } ShaderError;
 
+//
+// Fixed vertex attribute locations
+//
+// Every program linked by shaderLink() has the standard vertex attribute
+// variables bound to these locations, so vertex array state can be set
+// up once per object rather than looked up for each program.
+//
+
+typedef enum attrib_e {
+    A_POSITION, A_COLOR, A_NORMAL, A_TEXCOORD
+    // Sentinel gives us the number of attributes
+    , N_ATTRIBS
+} Attribute;
+
+// names of the attribute variables (must match the sequence above)
+extern const char *attribNames[ N_ATTRIBS ];
+
+//
+// Fixed uniform block binding points
+//
+// Uniform blocks with these names are connected to these binding points
+// when a program is linked, so one buffer bound there serves every
+// program which uses the block.
+//
+
+typedef enum block_e {
+    B_FRAME,        // per-frame camera, projection, and lighting data
+    B_OBJECTS       // per-object data for multi-draw rendering
+    // Sentinel gives us the number of blocks
+    , N_BLOCKS
+} Block;
+
+// names of the uniform blocks (must match the sequence above)
+extern const char *blockNames[ N_BLOCKS ];
+
+//
+// Standard uniform variables
+//
+// When shaderLink() links a program, it reflects the program's active
+// uniforms and attributes once and records the locations of these
+// (and of the standard attributes) in a table for that program, so
+// that drawing code never has to look a location up by name.
+//
+
+typedef enum uniform_e {
+    U_VIEWMAT, U_PROJMAT, U_MODELMAT,
+    U_MODELVIEWMAT, U_MVPMAT, U_NORMALMAT,
+    U_LIGHTPOSITION, U_LIGHTCOLOR, U_AMBIENTLIGHT,
+    U_AMBIENTCOLOR, U_DIFFUSECOLOR, U_SPECULARCOLOR, U_SPECEXP, U_KCOEFF,
+    U_TEXTURES, U_LAYER, U_OBJECTBASE, U_BACKTEXTURE, U_BACKLAYER
+    // Sentinel gives us the number of uniforms
+    , N_UNIFORMS
+} Uniform;
+
+// names of the uniform variables (must match the sequence above)
+extern const char *uniformNames[ N_UNIFORMS ];
+
+///
+/// uniformLoc(program,which)
+///
+/// Location of a standard uniform variable in a program linked by
+/// shaderLink().  For arrays, this is the location of the first entry.
+///
+/// @param program   the shader program
+/// @param which     the uniform variable
+/// @return          its location, or -1 if the program doesn't use it
+///                  (or it is part of a uniform block)
+///
+GLint uniformLoc( GLuint program, Uniform which );
+
+///
+/// attribLoc(program,which)
+///
+/// Location of a standard vertex attribute in a program linked by
+/// shaderLink().
+///
+/// @param program   the shader program
+/// @param which     the attribute
+/// @return          its location, or -1 if the program doesn't use it
+///
+GLint attribLoc( GLuint program, Attribute which );
+
 ///
 /// readTextFile(name)
 ///
@@ -89,7 +171,10 @@ GLuint shaderCreate( const GLchar **src, GLenum type, ShaderError *err );
 ///
 /// shaderLink( GLuint ids[], size_t num, ShaderError *err )
 ///
-/// Link a collection of shaders into a shader program.
+/// Link a collection of shaders into a shader program.  The standard
+/// vertex attributes are bound to their fixed locations first; afterward,
+/// the standard uniform blocks are connected to their binding points and
+/// the program's location table is built.
 ///
 /// @param ids   array of shader object ids
 /// @param num   number of elements in the array
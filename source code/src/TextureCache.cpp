@@ -0,0 +1,571 @@
+//
+//  TextureCache.cpp
+//
+//  Mip chains, block-compressed textures, and a disk cache of them.
+//
+//  The BC1 encoder is a fast one, after J.M.P. van Waveren's "Real-Time
+//  DXT Compression": each 4x4 block's endpoints are the corners of its
+//  colors' bounding box (along the diagonal which best follows them),
+//  inset slightly, and each texel takes the nearest of the four colors
+//  they define.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#endif
+
+#include "TextureCache.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// bump this whenever the encoder, the resampling, or the mip filter
+// changes, so that existing cache entries are rebuilt
+#define CACHE_VERSION   3
+
+// the start of each cache file
+typedef struct cacheheader_s {
+    char magic[4];              // "TXC1"
+    uint32_t version;           // CACHE_VERSION
+    uint32_t width, height;     // size of level 0
+    uint32_t levels;            // number of mip levels
+    uint32_t size;              // bytes of compressed data which follow
+} CacheHeader;
+
+static const char cacheMagic[4] = { 'T', 'X', 'C', '1' };
+
+// largest width or height accepted from a cache file
+#define MAX_CACHED_SIZE 16384
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Quantize a color to 5:6:5
+///
+static uint16_t to565( const int c[3] )
+{
+    return (uint16_t) ( ((c[0] * 31 + 127) / 255) << 11 |
+                        ((c[1] * 63 + 127) / 255) << 5 |
+                        ((c[2] * 31 + 127) / 255) );
+}
+
+///
+/// Expand a 5:6:5 color to 8 bits per channel, as the hardware does
+///
+static void from565( uint16_t v, int c[3] )
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+///
+/// Compress one 4x4 block of texels
+///
+/// @param px    the texels (RGB, in rows)
+/// @param out   the 8-byte BC1 block
+///
+static void encodeBlock( const unsigned char px[16][3], unsigned char out[8] )
+{
+    int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+    int mean[3] = { 0, 0, 0 };
+
+    for( int i = 0; i < 16; ++i ) {
+        for( int c = 0; c < 3; ++c ) {
+            lo[c] = min( lo[c], (int) px[i][c] );
+            hi[c] = max( hi[c], (int) px[i][c] );
+            mean[c] += px[i][c];
+        }
+    }
+
+    // the box's main diagonal runs from lo to hi; if red or blue
+    // falls as green rises, the colors follow another diagonal
+    int rg = 0, bg = 0;
+    for( int i = 0; i < 16; ++i ) {
+        int g = px[i][1] * 16 - mean[1];
+        rg += (px[i][0] * 16 - mean[0]) * g;
+        bg += (px[i][2] * 16 - mean[2]) * g;
+    }
+    if( rg < 0 ) {
+        swap( lo[0], hi[0] );
+    }
+    if( bg < 0 ) {
+        swap( lo[2], hi[2] );
+    }
+
+    // pull the endpoints in by 1/16 of the range; the extremes are
+    // rarely the best choice once the colors in between are quantized
+    for( int c = 0; c < 3; ++c ) {
+        int inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+
+    uint16_t c0 = to565( hi ), c1 = to565( lo );
+    if( c0 < c1 ) {
+        swap( c0, c1 );
+    }
+
+    // the four-color palette (c0 > c1), or a single color
+    int pal[4][3];
+    from565( c0, pal[0] );
+    from565( c1, pal[1] );
+    for( int c = 0; c < 3; ++c ) {
+        pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+        pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+    }
+
+    uint32_t bits = 0;
+    if( c0 != c1 ) {
+        for( int i = 0; i < 16; ++i ) {
+            int best = 0, bestDist = 1 << 30;
+            for( int p = 0; p < 4; ++p ) {
+                int dr = px[i][0] - pal[p][0];
+                int dg = px[i][1] - pal[p][1];
+                int db = px[i][2] - pal[p][2];
+                int dist = dr * dr + dg * dg + db * db;
+                if( dist < bestDist ) {
+                    best = p;
+                    bestDist = dist;
+                }
+            }
+            bits |= (uint32_t) best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xff;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xff;
+    out[3] = c1 >> 8;
+    out[4] = bits & 0xff;
+    out[5] = (bits >> 8) & 0xff;
+    out[6] = (bits >> 16) & 0xff;
+    out[7] = bits >> 24;
+}
+
+///
+/// Compress one mip level
+///
+/// @param rgba    the level's pixels
+/// @param w       its width
+/// @param h       its height
+/// @param out     where the blocks go (bc1Size(w,h) bytes)
+///
+static void encodeLevel( const unsigned char *rgba, int w, int h,
+                         unsigned char *out )
+{
+    unsigned char px[16][3];
+
+    for( int by = 0; by < h; by += 4 ) {
+        for( int bx = 0; bx < w; bx += 4 ) {
+            // blocks which hang over the edge repeat the last texel
+            for( int i = 0; i < 16; ++i ) {
+                int x = min( bx + (i & 3), w - 1 );
+                int y = min( by + (i >> 2), h - 1 );
+                memcpy( px[i], rgba + 4 * ((size_t) y * w + x), 3 );
+            }
+            encodeBlock( px, out );
+            out += 8;
+        }
+    }
+}
+
+///
+/// Halve an RGBA8 image in each dimension with a box filter
+///
+/// Each output texel is the rounded mean of a 2x2 square of input
+/// texels (with the last row or column repeated if the image is only
+/// one texel high or wide).  With SSE2, four output texels are made at
+/// once; the results are identical either way.
+///
+/// @param src   the image
+/// @param w     its width
+/// @param h     its height
+/// @param dst   the half-size image ((w/2) x (h/2), but at least 1x1)
+///
+static void downsample( const unsigned char *src, int w, int h,
+                        unsigned char *dst )
+{
+    int nw = max( w / 2, 1 ), nh = max( h / 2, 1 );
+
+    for( int y = 0; y < nh; ++y ) {
+        const unsigned char *r0 = src + 4 * (size_t) w * min( 2 * y, h - 1 );
+        const unsigned char *r1 = src + 4 * (size_t) w * min( 2 * y + 1, h - 1 );
+        unsigned char *out = dst + 4 * (size_t) nw * y;
+        int x = 0;
+
+#if defined(HAVE_SSE2)
+        if( w > 1 ) {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i two = _mm_set1_epi16( 2 );
+
+            for( ; x + 4 <= nw; x += 4 ) {
+                // eight texels from each row
+                __m128i a0 = _mm_loadu_si128( (const __m128i *) (r0 + 8 * x) );
+                __m128i a1 = _mm_loadu_si128( (const __m128i *) (r0 + 8 * x + 16) );
+                __m128i b0 = _mm_loadu_si128( (const __m128i *) (r1 + 8 * x) );
+                __m128i b1 = _mm_loadu_si128( (const __m128i *) (r1 + 8 * x + 16) );
+
+                // widened to 16 bits and summed down the columns,
+                // two texels to a register
+                __m128i s0 = _mm_add_epi16( _mm_unpacklo_epi8( a0, zero ),
+                                            _mm_unpacklo_epi8( b0, zero ) );
+                __m128i s1 = _mm_add_epi16( _mm_unpackhi_epi8( a0, zero ),
+                                            _mm_unpackhi_epi8( b0, zero ) );
+                __m128i s2 = _mm_add_epi16( _mm_unpacklo_epi8( a1, zero ),
+                                            _mm_unpacklo_epi8( b1, zero ) );
+                __m128i s3 = _mm_add_epi16( _mm_unpackhi_epi8( a1, zero ),
+                                            _mm_unpackhi_epi8( b1, zero ) );
+
+                // then across the pairs of columns
+                __m128i h0 = _mm_add_epi16( _mm_unpacklo_epi64( s0, s1 ),
+                                            _mm_unpackhi_epi64( s0, s1 ) );
+                __m128i h1 = _mm_add_epi16( _mm_unpacklo_epi64( s2, s3 ),
+                                            _mm_unpackhi_epi64( s2, s3 ) );
+
+                h0 = _mm_srli_epi16( _mm_add_epi16( h0, two ), 2 );
+                h1 = _mm_srli_epi16( _mm_add_epi16( h1, two ), 2 );
+                _mm_storeu_si128( (__m128i *) (out + 4 * x),
+                                  _mm_packus_epi16( h0, h1 ) );
+            }
+        }
+#endif
+
+        for( ; x < nw; ++x ) {
+            int x0 = 4 * min( 2 * x, w - 1 ), x1 = 4 * min( 2 * x + 1, w - 1 );
+            for( int c = 0; c < 4; ++c ) {
+                out[4 * x + c] = (r0[x0 + c] + r0[x1 + c] +
+                                  r1[x0 + c] + r1[x1 + c] + 2) / 4;
+            }
+        }
+    }
+}
+
+///
+/// Hash the contents of a file (64-bit FNV-1a)
+///
+/// @param path   the file
+/// @param key    filled in with the hash
+///
+/// @return false if the file can't be read
+///
+static bool hashFile( const char *path, uint64_t &key )
+{
+    FILE *fp = fopen( path, "rb" );
+    if( fp == NULL ) {
+        return( false );
+    }
+
+    unsigned char buf[65536];
+    size_t n;
+
+    key = 0xcbf29ce484222325ULL;
+    while( (n = fread( buf, 1, sizeof(buf), fp )) > 0 ) {
+        for( size_t i = 0; i < n; ++i ) {
+            key = (key ^ buf[i]) * 0x100000001b3ULL;
+        }
+    }
+    fclose( fp );
+
+    return( true );
+}
+
+///
+/// Name of the cache file for a key
+///
+static void cacheName( uint64_t key, char *name, size_t size )
+{
+    snprintf( name, size, CACHE_DIR "/%016llx.bc1",
+              (unsigned long long) key );
+}
+
+///
+/// Does a cache file's header describe a full BC1 mip chain?
+///
+/// Anything else (a corrupt or foreign file) would have us read past
+/// the end of its data when it is uploaded.
+///
+static bool validHeader( const CacheHeader &hdr )
+{
+    if( hdr.width == 0 || hdr.height == 0 ||
+        hdr.width > MAX_CACHED_SIZE || hdr.height > MAX_CACHED_SIZE ) {
+        return( false );
+    }
+
+    size_t total = 0;
+    uint32_t levels = 0;
+    int w = hdr.width, h = hdr.height;
+    for( ;; ) {
+        total += bc1Size( w, h );
+        ++levels;
+        if( w == 1 && h == 1 ) {
+            break;
+        }
+        w = max( w / 2, 1 );
+        h = max( h / 2, 1 );
+    }
+
+    return( hdr.levels == levels && hdr.size == total );
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Size of one level of a BC1-compressed image
+///
+/// @param width    width of the level
+/// @param height   height of the level
+///
+/// @return the size in bytes (8 per 4x4 block)
+///
+size_t bc1Size( int width, int height )
+{
+    return( (size_t) ((width + 3) / 4) * ((height + 3) / 4) * 8 );
+}
+
+///
+/// Resample an image to a new size
+///
+/// @param rgb         the RGB8 pixels, top row first
+/// @param width       image width
+/// @param height      image height
+/// @param outWidth    width of the resampled image
+/// @param outHeight   height of the resampled image
+/// @param out         filled in with the resampled RGB8 pixels
+///
+void resizeImage( const unsigned char *rgb, int width, int height,
+                  int outWidth, int outHeight, vector<unsigned char> &out )
+{
+    out.resize( 3 * (size_t) outWidth * outHeight );
+
+    // bilinear: each output texel's center is mapped back into the
+    // source image, and the four source texels around it are blended
+    // (clamping at the edges).  This blurs a little when shrinking a
+    // lot, but textures are only ever rounded to the nearest power of
+    // two, so no dimension shrinks by more than a factor of 1/sqrt(2)
+    float sx = (float) width / outWidth, sy = (float) height / outHeight;
+    unsigned char *dst = out.data();
+    for( int y = 0; y < outHeight; ++y ) {
+        float fy = max( (y + 0.5f) * sy - 0.5f, 0.0f );
+        int y0 = min( (int) fy, height - 1 );
+        int y1 = min( y0 + 1, height - 1 );
+        float ty = fy - y0;
+
+        const unsigned char *r0 = rgb + 3 * (size_t) y0 * width;
+        const unsigned char *r1 = rgb + 3 * (size_t) y1 * width;
+        for( int x = 0; x < outWidth; ++x ) {
+            float fx = max( (x + 0.5f) * sx - 0.5f, 0.0f );
+            int x0 = min( (int) fx, width - 1 );
+            int x1 = min( x0 + 1, width - 1 );
+            float tx = fx - x0;
+
+            for( int c = 0; c < 3; ++c ) {
+                float top = r0[3 * x0 + c] +
+                            tx * (r0[3 * x1 + c] - r0[3 * x0 + c]);
+                float bot = r1[3 * x0 + c] +
+                            tx * (r1[3 * x1 + c] - r1[3 * x0 + c]);
+                *dst++ = (unsigned char) (top + ty * (bot - top) + 0.5f);
+            }
+        }
+    }
+}
+
+///
+/// Build the mip chain for an image
+///
+/// @param rgb      the RGB8 pixels, top row first
+/// @param width    image width
+/// @param height   image height
+/// @param mips     filled in with the mip chain
+///
+void buildMips( const unsigned char *rgb, int width, int height,
+                MipChain &mips )
+{
+    mips.width = width;
+    mips.height = height;
+
+    // size everything up front
+    size_t total = 0;
+    int w = width, h = height;
+    for( mips.levels = 1; ; ++mips.levels ) {
+        total += 4 * (size_t) w * h;
+        if( w == 1 && h == 1 ) {
+            break;
+        }
+        w = max( w / 2, 1 );
+        h = max( h / 2, 1 );
+    }
+    mips.data.resize( total );
+
+    // level 0 is the image itself, widened to four channels so that
+    // each texel is one 32-bit word
+    unsigned char *cur = mips.data.data();
+    for( size_t i = 0; i < (size_t) width * height; ++i ) {
+        cur[4 * i] = rgb[3 * i];
+        cur[4 * i + 1] = rgb[3 * i + 1];
+        cur[4 * i + 2] = rgb[3 * i + 2];
+        cur[4 * i + 3] = 255;
+    }
+
+    // each level is made from the one before it
+    w = width;
+    h = height;
+    for( int l = 1; l < mips.levels; ++l ) {
+        unsigned char *next = cur + 4 * (size_t) w * h;
+        downsample( cur, w, h, next );
+        cur = next;
+        w = max( w / 2, 1 );
+        h = max( h / 2, 1 );
+    }
+}
+
+///
+/// Compress an image's mip chain
+///
+/// @param mips   the mip chain
+/// @param img    filled in with the compressed image
+///
+void compressImage( const MipChain &mips, CompressedImage &img )
+{
+    img.width = mips.width;
+    img.height = mips.height;
+    img.levels = mips.levels;
+
+    size_t total = 0;
+    int w = mips.width, h = mips.height;
+    for( int l = 0; l < mips.levels; ++l ) {
+        total += bc1Size( w, h );
+        w = max( w / 2, 1 );
+        h = max( h / 2, 1 );
+    }
+    img.data.resize( total );
+
+    const unsigned char *src = mips.data.data();
+    unsigned char *out = img.data.data();
+    w = mips.width;
+    h = mips.height;
+    for( int l = 0; l < mips.levels; ++l ) {
+        encodeLevel( src, w, h, out );
+        src += 4 * (size_t) w * h;
+        out += bc1Size( w, h );
+        w = max( w / 2, 1 );
+        h = max( h / 2, 1 );
+    }
+}
+
+///
+/// Look for an image file's compressed version in the cache
+///
+/// @param path   the image file
+/// @param key    filled in with the file's cache key (for cacheStore())
+/// @param img    filled in with the compressed image, if it was found
+///
+/// @return true if it was found
+///
+bool cacheLoad( const char *path, uint64_t &key, CompressedImage &img )
+{
+    key = 0;
+    if( !hashFile( path, key ) ) {
+        return( false );
+    }
+
+    char name[64];
+    cacheName( key, name, sizeof(name) );
+
+    FILE *fp = fopen( name, "rb" );
+    if( fp == NULL ) {
+        return( false );
+    }
+
+    CacheHeader hdr;
+    bool ok = fread( &hdr, sizeof(hdr), 1, fp ) == 1 &&
+              memcmp( hdr.magic, cacheMagic, 4 ) == 0 &&
+              hdr.version == CACHE_VERSION && validHeader( hdr );
+    if( ok ) {
+        img.width = hdr.width;
+        img.height = hdr.height;
+        img.levels = hdr.levels;
+        img.data.resize( hdr.size );
+        ok = fread( img.data.data(), 1, hdr.size, fp ) == hdr.size;
+    }
+    fclose( fp );
+
+    return( ok );
+}
+
+///
+/// Add a compressed image to the cache
+///
+/// @param key   the cache key given by cacheLoad()
+/// @param img   the compressed image
+///
+/// @return true if it was written
+///
+bool cacheStore( uint64_t key, const CompressedImage &img )
+{
+    if( key == 0 ) {
+        return( false );
+    }
+
+#if defined(_WIN32) || defined(_WIN64)
+    _mkdir( CACHE_DIR );
+#else
+    mkdir( CACHE_DIR, 0755 );
+#endif
+
+    // write to a private file, then move it into place, so that no
+    // one ever sees a partly-written entry
+    char name[64], tmp[96];
+    cacheName( key, name, sizeof(name) );
+    snprintf( tmp, sizeof(tmp), "%s.%zx", name,
+              hash<thread::id>()( this_thread::get_id() ) );
+
+    FILE *fp = fopen( tmp, "wb" );
+    if( fp == NULL ) {
+        return( false );
+    }
+
+    CacheHeader hdr;
+    memcpy( hdr.magic, cacheMagic, 4 );
+    hdr.version = CACHE_VERSION;
+    hdr.width = img.width;
+    hdr.height = img.height;
+    hdr.levels = img.levels;
+    hdr.size = img.data.size();
+
+    bool ok = fwrite( &hdr, sizeof(hdr), 1, fp ) == 1 &&
+              fwrite( img.data.data(), 1, img.data.size(), fp ) ==
+                  img.data.size();
+    ok = fclose( fp ) == 0 && ok;
+
+    if( !ok || rename( tmp, name ) != 0 ) {
+        remove( tmp );
+        return( false );
+    }
+
+    return( true );
+}
@@ -0,0 +1,121 @@
+//
+//  TextureCache.h
+//
+//  Mip chains, block-compressed textures, and a disk cache of them.
+//
+//  Mip chains are built on the CPU (with SSE2 where it's available)
+//  rather than by glGenerateMipmap(), so that they can be built by the
+//  image-loading threads and cached.
+//
+//  Decoding a JPEG or PNG file and building its mip chain costs far
+//  more than reading the same texture, already compressed and
+//  mipmapped, from disk.  The first time an image file is used, its
+//  mip chain is compressed to BC1 (S3TC DXT1, 4 bits per texel rather
+//  than the 32 the driver uses for RGB8) and written to the cache
+//  directory; later runs find it there.
+//
+//  Cache entries are named by a hash of the image file's contents, so
+//  a changed image is simply compressed again.  Stale entries are never
+//  removed; delete the cache directory to clear them out.
+//
+//  All of these functions may be called from any thread.
+//
+
+#ifndef TEXTURECACHE_H_
+#define TEXTURECACHE_H_
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// where the compressed textures are kept
+#define CACHE_DIR   "texcache"
+
+///
+/// An image's full mip chain, as RGBA8
+///
+typedef struct mipchain_s {
+    int width, height;          // size of level 0
+    int levels;                 // number of mip levels
+    vector<unsigned char> data; // the levels, largest first
+} MipChain;
+
+///
+/// A BC1-compressed image with its full mip chain
+///
+typedef struct compressed_s {
+    int width, height;          // size of level 0
+    int levels;                 // number of mip levels
+    vector<unsigned char> data; // the levels, largest first
+} CompressedImage;
+
+///
+/// Size of one level of a BC1-compressed image
+///
+/// @param width    width of the level
+/// @param height   height of the level
+///
+/// @return the size in bytes (8 per 4x4 block)
+///
+size_t bc1Size( int width, int height );
+
+///
+/// Resample an image to a new size
+///
+/// Each dimension is scaled separately, so the image is stretched if
+/// the new size has a different shape.
+///
+/// @param rgb         the RGB8 pixels, top row first
+/// @param width       image width
+/// @param height      image height
+/// @param outWidth    width of the resampled image
+/// @param outHeight   height of the resampled image
+/// @param out         filled in with the resampled RGB8 pixels
+///
+void resizeImage( const unsigned char *rgb, int width, int height,
+                  int outWidth, int outHeight, vector<unsigned char> &out );
+
+///
+/// Build the mip chain for an image
+///
+/// Each level is a 2x2 box filtering of the one before it, down to 1x1.
+///
+/// @param rgb      the RGB8 pixels, top row first
+/// @param width    image width
+/// @param height   image height
+/// @param mips     filled in with the mip chain
+///
+void buildMips( const unsigned char *rgb, int width, int height,
+                MipChain &mips );
+
+///
+/// Compress an image's mip chain
+///
+/// @param mips   the mip chain
+/// @param img    filled in with the compressed image
+///
+void compressImage( const MipChain &mips, CompressedImage &img );
+
+///
+/// Look for an image file's compressed version in the cache
+///
+/// @param path   the image file
+/// @param key    filled in with the file's cache key (for cacheStore())
+/// @param img    filled in with the compressed image, if it was found
+///
+/// @return true if it was found
+///
+bool cacheLoad( const char *path, uint64_t &key, CompressedImage &img );
+
+///
+/// Add a compressed image to the cache
+///
+/// @param key   the cache key given by cacheLoad()
+/// @param img   the compressed image
+///
+/// @return true if it was written
+///
+bool cacheStore( uint64_t key, const CompressedImage &img );
+
+#endif
@@ -0,0 +1,362 @@
+//
+//  Textures.cpp
+//
+//  Texture registry.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "Textures.h"
+
+#include "ImageLoader.h"
+#include "Profile.h"
+#include "Utils.h"
+
+using namespace std;
+
+//
+// PRIVATE GLOBALS
+//
+
+// one texture array, holding all the textures which share a sampler
+// and a size
+typedef struct texarray_s {
+    Sampler sampler;
+    int width, height;
+    GLint layers;
+    GLuint id;
+} TexArray;
+
+// one registered texture
+typedef struct texture_s {
+    int image;          // index of its image in 'images'
+    TextureRef ref;     // its array (by unit) and layer
+} Texture;
+
+// the arrays, in texture unit order, and the textures
+static vector<TexArray> arrays;
+static vector<Texture> textures;
+
+// the image files they use, each listed once, and the size each is
+// resampled to
+static vector<const char *> images;
+static vector<ImageSize> imageSizes;
+
+// are the textures BC1-compressed (and cached)?
+static bool compressed = false;
+
+//
+// PUBLIC GLOBALS
+//
+
+const Sampler repeatSampler = {
+    GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, 1.0f
+};
+
+//
+// PRIVATE FUNCTIONS
+//
+
+///
+/// Do two sets of sampler settings match?
+///
+static bool sameSampler( const Sampler &a, const Sampler &b )
+{
+    return a.wrap == b.wrap && a.magFilter == b.magFilter &&
+           a.minFilter == b.minFilter && a.anisotropy == b.anisotropy;
+}
+
+///
+/// Round a width or height to the nearest power of two
+///
+/// "Nearest" is by ratio, so that no image is scaled by more than
+/// sqrt(2) either way.
+///
+/// @param s   the width or height
+///
+/// @return the power of two, at most MAX_TEXTURE_SIZE
+///
+static int roundSize( int s )
+{
+    int p = 1;
+
+    while( p * 2 <= s && p < MAX_TEXTURE_SIZE ) {
+        p *= 2;
+    }
+    // s is between p and 2p; 2p is nearer if s/p > 2p/s
+    if( p < MAX_TEXTURE_SIZE && (long) s * s > 2L * p * p ) {
+        p *= 2;
+    }
+
+    return( p );
+}
+
+///
+/// Number of mip levels in a texture, down to 1x1
+///
+/// @param width    the texture's width
+/// @param height   the texture's height
+///
+static int levelCount( int width, int height )
+{
+    int levels = 1;
+
+    for( int s = max( width, height ); s > 1; s /= 2 ) {
+        ++levels;
+    }
+
+    return( levels );
+}
+
+//
+// PUBLIC FUNCTIONS
+//
+
+///
+/// Register a texture
+///
+/// Each array's layers are assigned in the order its textures are
+/// registered, starting from 0.
+///
+/// @param path      the image file
+/// @param sampler   how it is to be sampled
+///
+/// @return where the texture will be; the unit is -1 if there are
+///         already MAX_TEXTURES textures
+///
+TextureRef registerTexture( const char *path, const Sampler &sampler )
+{
+    TextureRef none = { -1, 0 };
+    int image, unit;
+
+    for( image = 0; image < (int) images.size(); ++image ) {
+        if( strcmp( images[image], path ) == 0 ) {
+            break;
+        }
+    }
+
+    // the texture's size, from its image file if it's new
+    ImageSize size;
+    if( image < (int) images.size() ) {
+        size = imageSizes[image];
+    } else if( imageFileSize( path, size.width, size.height ) ) {
+        size.width = roundSize( size.width );
+        size.height = roundSize( size.height );
+    } else {
+        size.width = size.height = DEFAULT_TEXTURE_SIZE;
+    }
+
+    for( unit = 0; unit < (int) arrays.size(); ++unit ) {
+        if( sameSampler( arrays[unit].sampler, sampler ) &&
+            arrays[unit].width == size.width &&
+            arrays[unit].height == size.height ) {
+            break;
+        }
+    }
+
+    for( size_t t = 0; t < textures.size(); ++t ) {
+        if( textures[t].image == image && textures[t].ref.unit == unit ) {
+            return( textures[t].ref );
+        }
+    }
+
+    if( textures.size() == MAX_TEXTURES ) {
+        cerr << "*** too many textures, can't add '" << path << "'" << endl;
+        return( none );
+    }
+    if( unit == MAX_TEXTURE_ARRAYS ) {
+        cerr << "*** too many texture arrays, can't add '" << path << "'"
+             << endl;
+        return( none );
+    }
+
+    if( image == (int) images.size() ) {
+        images.push_back( path );
+        imageSizes.push_back( size );
+    }
+    if( unit == (int) arrays.size() ) {
+        TexArray a = { sampler, size.width, size.height, 0, 0 };
+        arrays.push_back( a );
+    }
+
+    Texture t = { image, { unit, arrays[unit].layers++ } };
+    textures.push_back( t );
+
+    return( t.ref );
+}
+
+///
+/// How many texture arrays are there?
+///
+/// @return the number of arrays (and texture units in use)
+///
+int numTextureArrays( void )
+{
+    return( arrays.size() );
+}
+
+///
+/// Start decoding the images of the registered textures
+///
+/// @param compress   use BC1-compressed textures if we can?
+///
+void loadTextures( bool compress )
+{
+    compressed = compress && GLEW_EXT_texture_compression_s3tc;
+    if( compress && !compressed ) {
+        cerr << "S3TC texture compression not supported, using"
+             << " uncompressed textures" << endl;
+    }
+
+    startImageLoads( images.data(), images.size(), compressed,
+                     imageSizes.data() );
+}
+
+///
+/// Create the texture arrays, waiting for their images as needed
+///
+void uploadTextures( void )
+{
+    GLenum format = compressed ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_RGBA8;
+
+    // anisotropic filtering is core in 4.6, and an extension before
+    GLfloat maxAniso = 1.0f;
+    if( GLEW_VERSION_4_6 || GLEW_ARB_texture_filter_anisotropic ||
+        GLEW_EXT_texture_filter_anisotropic ) {
+        glGetFloatv( GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAniso );
+    }
+
+    // allocate every level of each array; the layers are filled in
+    // as their images arrive
+    size_t bytes = 0;
+    for( size_t u = 0; u < arrays.size(); ++u ) {
+        TexArray &a = arrays[u];
+        int levels = levelCount( a.width, a.height );
+
+        glGenTextures( 1, &a.id );
+        glActiveTexture( GL_TEXTURE0 + u );
+        glBindTexture( GL_TEXTURE_2D_ARRAY, a.id );
+        labelObject( GL_TEXTURE, a.id, "textures" );
+
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,
+                         a.sampler.wrap );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,
+                         a.sampler.wrap );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                         a.sampler.magFilter );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                         a.sampler.minFilter );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                         levels - 1 );
+        if( a.sampler.anisotropy > 1.0f && maxAniso > 1.0f ) {
+            glTexParameterf( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY,
+                             min( a.sampler.anisotropy, maxAniso ) );
+        }
+
+        int w = a.width, h = a.height;
+        for( int l = 0; l < levels; ++l ) {
+            if( compressed ) {
+                GLsizei size = bc1Size( w, h ) * a.layers;
+                glCompressedTexImage3D( GL_TEXTURE_2D_ARRAY, l, format,
+                    w, h, a.layers, 0, size, NULL );
+                bytes += size;
+            } else {
+                glTexImage3D( GL_TEXTURE_2D_ARRAY, l, format, w, h,
+                    a.layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+                bytes += 4 * (size_t) w * h * a.layers;
+            }
+            w = max( w / 2, 1 );
+            h = max( h / 2, 1 );
+        }
+    }
+
+    // upload each image as soon as it has been decoded, into every
+    // layer which uses it
+    Image img;
+    while( nextImage( img ) ) {
+        if( img.mips.levels == 0 && img.compressed.levels == 0 ) {
+            cerr << "*** SOIL loading error: can't load '" << img.path
+                 << "'" << endl;
+            continue;
+        }
+
+        // every array using the image is its size, so the image's own
+        // size is checked once; anything else would have us read past
+        // the end of its data
+        const ImageSize &size = imageSizes[img.index];
+        if( img.width != size.width || img.height != size.height ) {
+            cerr << "*** '" << img.path << "' is " << img.width << "x"
+                 << img.height << ", expected " << size.width << "x"
+                 << size.height << endl;
+            continue;
+        }
+        int levels = levelCount( size.width, size.height );
+
+        for( size_t t = 0; t < textures.size(); ++t ) {
+            const TextureRef &ref = textures[t].ref;
+            if( textures[t].image != img.index ) {
+                continue;
+            }
+
+            glActiveTexture( GL_TEXTURE0 + ref.unit );
+            glBindTexture( GL_TEXTURE_2D_ARRAY, arrays[ref.unit].id );
+
+            // the whole mip chain is in the image
+            int w = size.width, h = size.height;
+            if( compressed ) {
+                const unsigned char *data = img.compressed.data.data();
+                for( int l = 0; l < levels; ++l ) {
+                    GLsizei levelSize = bc1Size( w, h );
+                    glCompressedTexSubImage3D( GL_TEXTURE_2D_ARRAY, l,
+                        0, 0, ref.layer, w, h, 1, format, levelSize, data );
+                    data += levelSize;
+                    w = max( w / 2, 1 );
+                    h = max( h / 2, 1 );
+                }
+            } else {
+                const unsigned char *data = img.mips.data.data();
+                for( int l = 0; l < levels; ++l ) {
+                    glTexSubImage3D( GL_TEXTURE_2D_ARRAY, l,
+                        0, 0, ref.layer, w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        data );
+                    data += 4 * (size_t) w * h;
+                    w = max( w / 2, 1 );
+                    h = max( h / 2, 1 );
+                }
+            }
+        }
+    }
+
+    finishImageLoads();
+
+    // report the arrays (always in DEBUG builds; otherwise, only when
+    // profiling)
+#if defined(DEBUG)
+    bool report = true;
+#else
+    bool report = profiling();
+#endif
+    if( report ) {
+        cerr << "textures: " << textures.size() << " in " << arrays.size()
+             << (compressed ? " BC1" : " RGBA8") << " array(s), "
+             << bytes / 1024 << " KB" << endl;
+    }
+}
+
+///
+/// Abandon the image loads started by loadTextures()
+///
+void cancelTextureLoads( void )
+{
+    finishImageLoads();
+}
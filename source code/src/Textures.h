@@ -0,0 +1,123 @@
+//
+//  Textures.h
+//
+//  Texture registry.
+//
+//  A texture is identified by its image file and its sampler settings;
+//  registering the same pair again gives back the same texture, so each
+//  is loaded only once however many materials use it.
+//
+//  The textures are layers of 2D array textures, so that objects with
+//  different textures can be drawn without changing texture bindings
+//  (or with a single instanced or multi-draw call), with each draw
+//  choosing its layer.  Every layer of an array must be the same size,
+//  so each image is resampled when it is loaded, with each dimension
+//  rounded to the nearest power of two (so that each mip level is
+//  exactly half the size of the one before it, and no image is
+//  stretched or shrunk by more than a factor of sqrt(2)).  There is one
+//  array for each combination of sampler settings and rounded size;
+//  texture coordinates cover the whole of the image either way.  Each
+//  array is bound to its own texture unit for the life of the program.
+//
+//  Textures are registered first, then loadTextures() starts decoding
+//  their images in the background, and uploadTextures() creates the
+//  arrays and fills in the layers as the images become available.
+//
+
+#ifndef TEXTURES_H_
+#define TEXTURES_H_
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#endif
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+// the most textures we can have (the fewest array layers an
+// implementation may support)
+#define MAX_TEXTURES    256
+
+// the most texture arrays we can have (the fewest texture units a
+// fragment shader may use)
+#define MAX_TEXTURE_ARRAYS  16
+
+// the largest width or height of a texture (the smallest maximum
+// texture size an implementation may have); larger images are shrunk
+#define MAX_TEXTURE_SIZE    1024
+
+// the size given to a texture whose image file's size can't be read
+// (its image will most likely fail to load too)
+#define DEFAULT_TEXTURE_SIZE    256
+
+///
+/// How a texture is sampled
+///
+typedef struct sampler_s {
+    GLint wrap;         // wrap mode, in both s and t
+    GLint magFilter;    // magnification filter
+    GLint minFilter;    // minification filter
+    GLfloat anisotropy; // maximum anisotropy (1 for none); clamped
+                        // to what the implementation supports
+} Sampler;
+
+// repeated in both directions, with trilinear filtering
+extern const Sampler repeatSampler;
+
+///
+/// Where a texture lives
+///
+typedef struct textureref_s {
+    GLint unit;         // texture unit of its array (-1 if none)
+    GLint layer;        // its layer in that array
+} TextureRef;
+
+///
+/// Register a texture
+///
+/// The image file's header is read to find the size of its texture.
+/// Each array's layers are assigned in the order its textures are
+/// registered, starting from 0.
+///
+/// @param path      the image file
+/// @param sampler   how it is to be sampled
+///
+/// @return where the texture will be; the unit is -1 if there are
+///         already MAX_TEXTURES textures, or it would need more than
+///         MAX_TEXTURE_ARRAYS arrays
+///
+TextureRef registerTexture( const char *path, const Sampler &sampler );
+
+///
+/// How many texture arrays are there?
+///
+/// @return the number of arrays (and texture units in use)
+///
+int numTextureArrays( void );
+
+///
+/// Start decoding the images of the registered textures
+///
+/// Every texture gets a full mip chain, built on the CPU.  Compressed
+/// textures are BC1 (S3TC DXT1), built when the images are first used
+/// and kept in the texture cache (see TextureCache.h); they need
+/// EXT_texture_compression_s3tc.
+///
+/// @param compress   use BC1-compressed textures if we can?
+///
+void loadTextures( bool compress );
+
+///
+/// Create the texture arrays, waiting for their images as needed
+///
+void uploadTextures( void );
+
+///
+/// Abandon the image loads started by loadTextures(), waiting for the
+/// loading threads to exit
+///
+/// Call this if initialization fails before uploadTextures().
+///
+void cancelTextureLoads( void );
+
+#endif
@@ -12,6 +12,7 @@
 #include <cstdlib>
 // wimp out and use stdio
 #include <cstdio>
+#include <vector>
 
 #if defined(_WIN32) || defined(_WIN64)
 #include <windows.h>
@@ -24,6 +25,15 @@
 
 using namespace std;
 
+// rendering statistics for the current frame
+RenderStats renderStats;
+
+// is debug output on?
+static bool debugOn = false;
+
+// the debug groups currently open
+static vector<const char *> debugGroups;
+
 ///
 /// OpenGL error checking
 ///
@@ -72,6 +82,101 @@ void checkErrors( const char *msg ) {
     }
 }
 
+///
+/// Debug output callback
+///
+/// Reports one message from the driver, along with the debug groups
+/// that were open when it was issued.
+///
+static void GLAPIENTRY debugMessage( GLenum source, GLenum type, GLuint id,
+    GLenum severity, GLsizei length, const GLchar *message,
+    const void *user ) {
+    const char *sev, *kind;
+
+    switch( severity ) {
+    case GL_DEBUG_SEVERITY_HIGH:    sev = "high";    break;
+    case GL_DEBUG_SEVERITY_MEDIUM:  sev = "medium";  break;
+    case GL_DEBUG_SEVERITY_LOW:     sev = "low";     break;
+    default:                        sev = "info";
+    }
+
+    switch( type ) {
+    case GL_DEBUG_TYPE_ERROR:               kind = "error";        break;
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: kind = "deprecated";   break;
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  kind = "undefined";    break;
+    case GL_DEBUG_TYPE_PORTABILITY:         kind = "portability";  break;
+    case GL_DEBUG_TYPE_PERFORMANCE:         kind = "performance";  break;
+    default:                                kind = "other";
+    }
+
+    fprintf( stderr, "*** GL %s (%s, id %u)", kind, sev, id );
+    for( size_t i = 0; i < debugGroups.size(); ++i ) {
+        fprintf( stderr, "%s%s", i == 0 ? " in " : "/", debugGroups[i] );
+    }
+    fprintf( stderr, ": %s\n", message );
+}
+
+///
+/// Turn on OpenGL debug output
+///
+/// @return true if debug output is on
+///
+bool initDebugOutput( void ) {
+
+    if( !(GLEW_VERSION_4_3 || GLEW_KHR_debug) ) {
+        fputs( "Debug output not supported\n", stderr );
+        return( false );
+    }
+
+    glEnable( GL_DEBUG_OUTPUT );
+    // report each message from within the call that caused it, so
+    // that the group stack (and a debugger's backtrace) are accurate
+    glEnable( GL_DEBUG_OUTPUT_SYNCHRONOUS );
+    glDebugMessageCallback( debugMessage, NULL );
+
+    // skip the chatter (including the group push/pop notices)
+    glDebugMessageControl( GL_DONT_CARE, GL_DONT_CARE,
+        GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE );
+
+    debugOn = true;
+    return( true );
+}
+
+///
+/// Give an OpenGL object a name to be used in debug messages
+///
+/// @param type   the kind of object (GL_BUFFER, GL_PROGRAM, GL_TEXTURE, ...)
+/// @param id     the object
+/// @param label  its name
+///
+void labelObject( GLenum type, GLuint id, const char *label ) {
+    if( debugOn ) {
+        glObjectLabel( type, id, -1, label );
+    }
+}
+
+///
+/// Open a debug group
+///
+/// @param name   the group's name
+///
+DebugGroup::DebugGroup( const char *name ) : pushed(debugOn) {
+    if( pushed ) {
+        glPushDebugGroup( GL_DEBUG_SOURCE_APPLICATION, 0, -1, name );
+        debugGroups.push_back( name );
+    }
+}
+
+///
+/// Close a debug group
+///
+DebugGroup::~DebugGroup( void ) {
+    if( pushed ) {
+        debugGroups.pop_back();
+        glPopDebugGroup();
+    }
+}
+
 ///
 /// Convert a type number to a string.
 ///
@@ -167,6 +272,9 @@ void dumpActives( GLuint program ) {
 ///
 /// Retrieve a Uniform variable's location and verify the result
 ///
+/// This queries OpenGL by name on every call; drawing code should use
+/// the location tables instead (see uniformLoc() in ShaderSetup.h).
+///
 /// @param program  the shader program
 /// @param name     the name of the desired variable
 ///
@@ -23,6 +23,22 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+//
+// Rendering statistics
+//
+// Counts of the state changes made while drawing a frame; the drawing
+// code resets these at the start of each frame.
+//
+typedef struct renderstats_s {
+    int programs;   // shader program switches
+    int textures;   // texture (unit) changes
+    int uniforms;   // uniform uploads
+    int draws;      // draw calls
+    long triangles; // triangles drawn
+} RenderStats;
+
+extern RenderStats renderStats;
+
 ///
 /// OpenGL error checking
 ///
@@ -35,6 +51,63 @@
 ///
 void checkErrors( const char *msg );
 
+//
+// Error checks made while drawing (once per object or per frame) are
+// only compiled into DEBUG builds; glGetError() can stall the pipeline.
+// Use debug output (below) to find errors in release builds.
+//
+#if defined(DEBUG)
+#define CHECK_ERRORS(msg)   checkErrors( msg )
+#else
+#define CHECK_ERRORS(msg)   ((void) 0)
+#endif
+
+///
+/// Turn on OpenGL debug output
+///
+/// Errors, and warnings about performance and undefined behavior, are
+/// reported through a callback as they happen, rather than having to be
+/// polled for with checkErrors().  Needs OpenGL 4.3 or KHR_debug, and
+/// most drivers only say much in a debug context (see main.cpp).
+///
+/// @return true if debug output is on
+///
+bool initDebugOutput( void );
+
+///
+/// Give an OpenGL object a name to be used in debug messages (and by
+/// debugging tools such as RenderDoc); does nothing without debug output
+///
+/// @param type   the kind of object (GL_BUFFER, GL_PROGRAM, GL_TEXTURE, ...)
+/// @param id     the object
+/// @param label  its name
+///
+void labelObject( GLenum type, GLuint id, const char *label );
+
+///
+/// A named debug group, from construction to destruction
+///
+/// Debug messages are reported with the names of the groups they were
+/// issued in, and debugging tools show each group's commands together.
+/// Does nothing without debug output.  The name must outlive the group.
+///
+class DebugGroup {
+
+    bool pushed;
+
+public:
+    DebugGroup( const char *name );
+    ~DebugGroup( void );
+
+};
+
+#define DEBUG_CAT2(a,b)     a##b
+#define DEBUG_CAT(a,b)      DEBUG_CAT2(a,b)
+
+// put the rest of the enclosing block in a debug group
+#define DEBUG_GROUP(name) \
+    DebugGroup DEBUG_CAT(debugGroup_,__LINE__)( name )
+
 ///
 /// Convert a type number to a string.
 ///
@@ -58,6 +131,9 @@ void dumpActives( GLuint program );
 ///
 /// Retrieve a Uniform variable's location and verify the result
 ///
+/// This queries OpenGL by name on every call; drawing code should use
+/// the location tables instead (see uniformLoc() in ShaderSetup.h).
+///
 /// @param program  the shader program
 /// @param name     the name of the desired variable
 ///
@@ -17,11 +17,15 @@
 #include <cstring>
 
 #include "Viewing.h"
+#include "Models.h"
+#include "ShaderSetup.h"
 #include "Utils.h"
 
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
+#include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/matrix.hpp>
 #include <glm/geometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -43,6 +47,33 @@ static GLfloat bounds[] = { -1.0f, 1.0f, 1.0f, -1.0f, 3.0f, 100.5f };
 #define NEAR    bounds[4]
 #define FAR     bounds[5]
 
+///
+/// This function computes the frustum projection of the scene.
+///
+/// @return the projection matrix
+///
+glm::mat4 projectionMatrix( void )
+{
+    // the frustum never changes, so this is only computed once
+    static const glm::mat4 pMat =
+        glm::frustum( LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR );
+
+    return pMat;
+}
+
+///
+/// This function computes the viewing (camera) transformation.
+///
+/// @return the view matrix
+///
+glm::mat4 viewMatrix( void )
+{
+    // nor does the camera move
+    static const glm::mat4 vMat = glm::lookAt( eye, lookat, up );
+
+    return vMat;
+}
+
 ///
 /// This function sets up a frustum projection of the scene.
 ///
@@ -51,27 +82,27 @@ static GLfloat bounds[] = { -1.0f, 1.0f, 1.0f, -1.0f, 3.0f, 100.5f };
 ///
 void setProjection( GLuint program )
 {
-    glm::mat4 pmat = glm::frustum( LEFT, RIGHT, BOTTOM, TOP, NEAR, FAR );
+    glm::mat4 pmat = projectionMatrix();
 
-    GLint loc = getUniformLoc( program, "projMat" );
+    GLint loc = uniformLoc( program, U_PROJMAT );
     if( loc >= 0 ) {
         glUniformMatrix4fv( loc, 1, GL_FALSE, glm::value_ptr(pmat) );
+        ++renderStats.uniforms;
     }
 }
 
 ///
-/// This function sets up the transformation parameters for the vertices
-/// of the object.  The order of application is fixed: scaling, Z rotation,
-/// Y rotation, X rotation, and then translation.
+/// This function computes the model transformation for an object.  The
+/// order of application is fixed: scaling, Z rotation, Y rotation,
+/// X rotation, and then translation.
 ///
-/// @param program - The ID of an OpenGL (GLSL) shader program to which
-///    parameter values are to be sent
 /// @param scale  - scale factors for each axis
 /// @param rotate - rotation angles around the three axes, in degrees
 /// @param xlate  - amount of translation along each axis
 ///
-void setTransforms( GLuint program, glm::vec3 scale,
-                    glm::vec3 rotate, glm::vec3 xlate )
+/// @return the model matrix
+///
+glm::mat4 modelMatrix( glm::vec3 scale, glm::vec3 rotate, glm::vec3 xlate )
 {
     // need an identity matrix
     glm::mat4 id(1.0f);
@@ -88,11 +119,88 @@ void setTransforms( GLuint program, glm::vec3 scale,
     glm::mat4 zMat = glm::rotate( id, rads.z, glm::vec3(0.0f,0.0f,1.0f) );
 
     // combine the transformations
-    glm::mat4 cm = tMat * xMat * yMat * zMat * sMat;
+    return tMat * xMat * yMat * zMat * sMat;
+}
+
+///
+/// This function computes the eye space transformations for an object,
+/// so that the shaders need not do so for every vertex.
+///
+/// @param model     - the object's model matrix
+/// @param modelView - filled in with the view * model matrix
+/// @param mvp       - filled in with the projection * view * model matrix
+/// @param normal    - filled in with the normal matrix (the inverse
+///                    transpose of the upper left 3x3 of modelView)
+///
+void eyeTransforms( const glm::mat4 &model, glm::mat4 &modelView,
+                    glm::mat4 &mvp, glm::mat3 &normal )
+{
+    modelView = viewMatrix() * model;
+    mvp = projectionMatrix() * modelView;
+    normal = glm::transpose( glm::inverse( glm::mat3(modelView) ) );
+}
+
+///
+/// This function sets up the transformation parameters for the vertices
+/// of the object.  The order of application is fixed: scaling, Z rotation,
+/// Y rotation, X rotation, and then translation.
+///
+/// @param program - The ID of an OpenGL (GLSL) shader program to which
+///    parameter values are to be sent
+/// @param scale  - scale factors for each axis
+/// @param rotate - rotation angles around the three axes, in degrees
+/// @param xlate  - amount of translation along each axis
+///
+void setTransforms( GLuint program, glm::vec3 scale,
+                    glm::vec3 rotate, glm::vec3 xlate )
+{
+    glm::mat4 cm = modelMatrix( scale, rotate, xlate );
+
+    setInstanceTransforms( program, &cm, 1 );
+}
 
-    GLint loc = getUniformLoc( program, "modelMat" );
+///
+/// This function sends the model transformations for a group of
+/// instances to a shader program, along with the modelView, MVP, and
+/// normal matrices derived from them (each only if the program uses it).
+///
+/// @param program - The ID of an OpenGL (GLSL) shader program to which
+///    parameter values are to be sent
+/// @param mats   - the model matrices, in instance order
+/// @param n      - how many there are (at most MAX_INSTANCES)
+///
+void setInstanceTransforms( GLuint program, const glm::mat4 *mats, int n )
+{
+    GLint loc = uniformLoc( program, U_MODELMAT );
     if( loc >= 0 ) {
-        glUniformMatrix4fv( loc, 1, GL_FALSE, glm::value_ptr(cm) );
+        glUniformMatrix4fv( loc, n, GL_FALSE, glm::value_ptr(mats[0]) );
+        ++renderStats.uniforms;
+    }
+
+    GLint mvLoc = uniformLoc( program, U_MODELVIEWMAT );
+    GLint mvpLoc = uniformLoc( program, U_MVPMAT );
+    GLint nLoc = uniformLoc( program, U_NORMALMAT );
+    if( mvLoc < 0 && mvpLoc < 0 && nLoc < 0 ) {
+        return;
+    }
+
+    glm::mat4 mv[MAX_INSTANCES], mvp[MAX_INSTANCES];
+    glm::mat3 norm[MAX_INSTANCES];
+    for( int i = 0; i < n; ++i ) {
+        eyeTransforms( mats[i], mv[i], mvp[i], norm[i] );
+    }
+
+    if( mvLoc >= 0 ) {
+        glUniformMatrix4fv( mvLoc, n, GL_FALSE, glm::value_ptr(mv[0]) );
+        ++renderStats.uniforms;
+    }
+    if( mvpLoc >= 0 ) {
+        glUniformMatrix4fv( mvpLoc, n, GL_FALSE, glm::value_ptr(mvp[0]) );
+        ++renderStats.uniforms;
+    }
+    if( nLoc >= 0 ) {
+        glUniformMatrix3fv( nLoc, n, GL_FALSE, glm::value_ptr(norm[0]) );
+        ++renderStats.uniforms;
     }
 }
 
@@ -106,11 +214,12 @@ void setTransforms( GLuint program, glm::vec3 scale,
 void setCamera( GLuint program )
 {
     // calculate our camera matrix
-    glm::mat4 vMat = glm::lookAt( eye, lookat, up );
+    glm::mat4 vMat = viewMatrix();
 
     // copy it down to the shader program
-    GLint loc = getUniformLoc( program, "viewMat" );
+    GLint loc = uniformLoc( program, U_VIEWMAT );
     if( loc >= 0 ) {
         glUniformMatrix4fv( loc, 1, GL_FALSE, glm::value_ptr(vMat) );
+        ++renderStats.uniforms;
     }
 }
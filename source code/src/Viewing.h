@@ -22,6 +22,22 @@
 #include <GLFW/glfw3.h>
 
 #include <glm/vec3.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+
+///
+/// This function computes the frustum projection of the scene.
+///
+/// @return the projection matrix
+///
+glm::mat4 projectionMatrix( void );
+
+///
+/// This function computes the viewing (camera) transformation.
+///
+/// @return the view matrix
+///
+glm::mat4 viewMatrix( void );
 
 ///
 /// This function sets up a frustum projection of the scene.
@@ -31,6 +47,32 @@
 ///
 void setProjection( GLuint program );
 
+///
+/// This function computes the model transformation for an object.  The
+/// order of application is fixed: scaling, Z rotation, Y rotation,
+/// X rotation, and then translation.
+///
+/// @param scale     Scale factors for each axis
+/// @param rotate    Rotation angles around the three axes, in degrees
+/// @param xlate     Amount of translation along each axis
+///
+/// @return the model matrix
+///
+glm::mat4 modelMatrix( glm::vec3 scale, glm::vec3 rotate, glm::vec3 xlate );
+
+///
+/// This function computes the eye space transformations for an object,
+/// so that the shaders need not do so for every vertex.
+///
+/// @param model     The object's model matrix
+/// @param modelView Filled in with the view * model matrix
+/// @param mvp       Filled in with the projection * view * model matrix
+/// @param normal    Filled in with the normal matrix (the inverse
+///                  transpose of the upper left 3x3 of modelView)
+///
+void eyeTransforms( const glm::mat4 &model, glm::mat4 &modelView,
+                    glm::mat4 &mvp, glm::mat3 &normal );
+
 ///
 /// This function sets up the transformation parameters for the vertices
 /// of the object.  The order of application is fixed: scaling, Z rotation,
@@ -45,6 +87,18 @@ void setProjection( GLuint program );
 void setTransforms( GLuint program, glm::vec3 scale,
                     glm::vec3 rotate, glm::vec3 xlate );
 
+///
+/// This function sends the model transformations for a group of
+/// instances to a shader program, along with the modelView, MVP, and
+/// normal matrices derived from them (each only if the program uses it).
+///
+/// @param program   The ID of an OpenGL (GLSL) shader program to which
+///    parameter values are to be sent
+/// @param mats      The model matrices, in instance order
+/// @param n         How many there are (at most MAX_INSTANCES)
+///
+void setInstanceTransforms( GLuint program, const glm::mat4 *mats, int n );
+
 ///
 /// This function sets up the camera parameters controlling the viewing
 /// transformation.
@@ -44,15 +44,15 @@ FMWKS =
 # FMWKS += -framework OpenGL -framework Cocoa
 # FMWKS += -framework IOKit -framework CoreVideo
 
-# common compiler flags
-CCFLAGS = -ggdb $(INCLUDE) -DGL_GLEXT_PROTOTYPES
+# common compiler flags (textures are decoded on worker threads)
+CCFLAGS = -ggdb -pthread $(INCLUDE) -DGL_GLEXT_PROTOTYPES
 
 # language-specific compiler flags
 CFLAGS = -std=c99 $(CCFLAGS)
 CXXFLAGS = $(CCFLAGS) -DGL_SILENCE_DEPRECATION
 
 # common linker flags
-LIBFLAGS = -ggdb $(LIBDIRS) $(LDLIBS)
+LIBFLAGS = -ggdb -pthread $(LIBDIRS) $(LDLIBS)
 
 # language-specific linker flags
 CLIBFLAGS = $(LIBFLAGS) $(CLDLIBS)
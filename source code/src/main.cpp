@@ -12,6 +12,7 @@
 //
 
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -25,10 +26,24 @@
 #include <GLFW/glfw3.h>
 
 #include "Application.h"
+#include "Profile.h"
 #include "Utils.h"
 
 using namespace std;
 
+// running the headless benchmark (--bench)?
+static bool headless = false;
+
+// report GLFW errors without exiting (while trying context types)
+static bool quietErrors = false;
+
+// ask for a debug context?  (see --gldebug in Application.cpp)
+#if defined(DEBUG)
+static bool debugContext = true;
+#else
+static bool debugContext = false;
+#endif
+
 //
 // Event callback routines
 //
@@ -45,7 +60,46 @@ using namespace std;
 void glfwError( int code, const char *desc )
 {
     cerr << "GLFW error " << code << ": " << desc << endl;
-    exit( 2 );
+    if( !quietErrors ) {
+        exit( 2 );
+    }
+}
+
+///
+/// Create our window and its GL context
+///
+/// For the headless benchmark, the window is never shown, and the
+/// context may come from EGL (which can work without a display) or
+/// OSMesa (which renders in software) if the native API can't make
+/// one; each is tried in turn.
+///
+/// @return the window, or NULL
+///
+static GLFWwindow *createWindow( void )
+{
+    if( !headless ) {
+        return glfwCreateWindow( w_width, w_height, w_title, NULL, NULL );
+    }
+
+    glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+
+#if defined(GLFW_OSMESA_CONTEXT_API)
+    const int apis[] = {
+        GLFW_NATIVE_CONTEXT_API, GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API
+    };
+    GLFWwindow *window = NULL;
+
+    quietErrors = true;
+    for( int i = 0; i < 3 && window == NULL; ++i ) {
+        glfwWindowHint( GLFW_CONTEXT_CREATION_API, apis[i] );
+        window = glfwCreateWindow( w_width, w_height, w_title, NULL, NULL );
+    }
+    quietErrors = false;
+
+    return window;
+#else
+    return glfwCreateWindow( w_width, w_height, w_title, NULL, NULL );
+#endif
 }
 
 
@@ -59,6 +113,22 @@ int main( int argc, char *argv[] )
 {
     glfwSetErrorCallback( glfwError );
 
+    for( int i = 1; i < argc; ++i ) {
+        if( strcmp( argv[i], "--bench" ) == 0 ) {
+            headless = true;
+        } else if( strcmp( argv[i], "--gldebug" ) == 0 ) {
+            debugContext = true;
+        }
+    }
+
+#if defined(GLFW_PLATFORM_NULL)
+    // with no display server to talk to, use GLFW's null platform
+    if( headless && getenv( "DISPLAY" ) == NULL &&
+        getenv( "WAYLAND_DISPLAY" ) == NULL ) {
+        glfwInitHint( GLFW_PLATFORM, GLFW_PLATFORM_NULL );
+    }
+#endif
+
     if( !glfwInit() ) {
         cerr << "Can't initialize GLFW!" << endl;
         exit( 1 );
@@ -72,8 +142,13 @@ int main( int argc, char *argv[] )
     glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
     glfwWindowHint( GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE );
 
+    // most drivers only produce useful debug output in a debug context
+    if( debugContext ) {
+        glfwWindowHint( GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE );
+    }
+
     // w_width, w_height, and w_title come from the Application module
-    w_window = glfwCreateWindow( w_width, w_height, w_title, NULL, NULL );
+    w_window = createWindow();
 
     if( !w_window ) {
         cerr << "GLFW window create failed!" << endl;
@@ -108,6 +183,9 @@ int main( int argc, char *argv[] )
     // do all application-specific work
     application( argc, argv );
 
+    // write out the profile (if one was requested)
+    profileFinish();
+
     // all done - shut everything down cleanly
     glfwDestroyWindow( w_window );
     glfwTerminate();
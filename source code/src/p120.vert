@@ -31,7 +31,10 @@ attribute vec2 vTexCoord;
 uniform mat4 viewMat;   // view (camera)
 uniform mat4 projMat;   // projection
 
-uniform mat4 modelMat;  // composite
+// Object transformations, computed by the application
+uniform mat4 modelViewMat;  // view * model
+uniform mat4 mvpMat;        // projection * view * model
+uniform mat3 normalMat;     // inverse transpose of modelView
 
 // Light position is given in world space
 uniform vec4 lightPosition;
@@ -46,54 +49,8 @@ varying vec3 lPos;
 varying vec3 vPos;
 varying vec3 vNorm;
 
-//
-// Inversion function for 3x3 matrices by Mikola Lysenko.
-// Origin: https://github.com/glslify/glsl-inverse/blob/master/index.glsl
-//
-// The MIT License (MIT)
-//
-// Copyright (c) 2014 Mikola Lysenko
-//
-// Permission is hereby granted, free of charge, to any person obtaining a
-// copy of this software and associated documentation files (the "Software"),
-// to deal in the Software without restriction, including without limitation
-// the rights to use, copy, modify, merge, publish, distribute, sublicense,
-// and/or sell copies of the Software, and to permit persons to whom the
-// Software is furnished to do so, subject to the following conditions:
-//
-// The above copyright notice and this permission notice shall be included
-// in all copies or substantial portions of the Software.
-//
-// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
-// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
-// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
-// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
-// OTHER DEALINGS IN THE SOFTWARE.
-//
-
-mat3 inverse(mat3 m) {
-  float a00 = m[0][0], a01 = m[0][1], a02 = m[0][2];
-  float a10 = m[1][0], a11 = m[1][1], a12 = m[1][2];
-  float a20 = m[2][0], a21 = m[2][1], a22 = m[2][2];
-
-  float b01 = a22 * a11 - a12 * a21;
-  float b11 = -a22 * a10 + a12 * a20;
-  float b21 = a21 * a10 - a11 * a20;
-
-  float det = a00 * b01 + a01 * b11 + a02 * b21;
-
-  return mat3(b01, (-a22 * a01 + a02 * a21), (a12 * a01 - a02 * a11),
-              b11, (a22 * a00 - a02 * a20), (-a12 * a00 + a02 * a10),
-              b21, (-a21 * a00 + a01 * a20), (a11 * a00 - a01 * a10)) / det;
-}
-
 void main()
 {
-    // create the modelview matrix
-    mat4 modelViewMat = viewMat * modelMat;
-
     // All vectors need to be converted to "eye" space
     // All vectors should also be normalized
     vec4 vertexInEye = modelViewMat * vPosition;
@@ -101,11 +58,9 @@ void main()
 
     // "Correct" way to transform normals.  The normal matrix is the
     // inverse transpose of the upper left 3x3 submatrix of the modelView
-    // matrix (i.e., does not include translations).  THIS IS EXPENSIVE
-    // TO COMPUTE because of the inverse(), and should really be done in
-    // the application, not here.
-    mat3 normMat = inverse( transpose( mat3(modelViewMat) ) );
-    vec4 normalInEye = vec4( normMat * vNormal, 0.0 );
+    // matrix (i.e., does not include translations); it is expensive to
+    // compute, so the application does it once per object.
+    vec4 normalInEye = vec4( normalMat * vNormal, 0.0 );
 
     // pass our vertex data to the fragment shader
     lPos = lightInEye.xyz;
@@ -113,5 +68,5 @@ void main()
     vNorm = normalInEye.xyz;
 
     // send the vertex position into clip space
-    gl_Position =  projMat * modelViewMat * vPosition;
+    gl_Position =  mvpMat * vPosition;
 }
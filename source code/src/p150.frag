@@ -26,19 +26,28 @@ in vec3 vNorm;
 // Texture coordinates
 in vec2 texCoord;
 
+// Which instance this fragment belongs to
+flat in int instance;
+
 //
 // Data coming from the application
 //
 
-// Light color
-uniform vec4 lightColor;
-uniform vec4 ambientLight;
-
-// Material properties
-uniform vec4 diffuseColor;
-uniform vec4 ambientColor;
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Material properties (the colors and exponent are per instance)
+uniform vec4 diffuseColor[8];
+uniform vec4 ambientColor[8];
 uniform vec4 specularColor;
-uniform float specExp;
+uniform float specExp[8];
 uniform vec3 kCoeff;
 
 // OUTGOING DATA
@@ -60,9 +69,9 @@ void main()
     float specDot;  // specular dot(R,V) ^ specExp value
 
     // old, Phong calculations
-    ambient  = ambientLight * ambientColor;
-    diffuse  = lightColor * diffuseColor * max(dot(N,L),0.0);
-    specDot  = pow( max(dot(R,V),0.0), specExp );
+    ambient  = ambientLight * ambientColor[instance];
+    diffuse  = lightColor * diffuseColor[instance] * max(dot(N,L),0.0);
+    specDot  = pow( max(dot(R,V),0.0), specExp[instance] );
     specular = lightColor * specularColor * specDot;
 
     // calculate the final color
@@ -27,14 +27,21 @@ in vec2 vTexCoord;
 // Uniform data
 //
 
-// Camera and projection matrices
-uniform mat4 viewMat;   // view (camera)
-uniform mat4 projMat;   // projection
-
-uniform mat4 modelMat;  // composite
-
-// Light position is given in world space
-uniform vec4 lightPosition;
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Transformations for each instance (a single object drawn without
+// instancing uses the first entry), computed by the application
+uniform mat4 modelViewMat[8];   // view * model
+uniform mat4 mvpMat[8];         // projection * view * model
+uniform mat3 normalMat[8];      // inverse transpose of modelView
 
 //
 // OUTGOING DATA
@@ -46,23 +53,23 @@ out vec3 lPos;
 out vec3 vPos;
 out vec3 vNorm;
 
+// Which instance this vertex belongs to
+flat out int instance;
+
 void main()
 {
-    // create the modelview matrix
-    mat4 modelViewMat = viewMat * modelMat;
+    instance = gl_InstanceID;
 
     // All vectors need to be converted to "eye" space
     // All vectors should also be normalized
-    vec4 vertexInEye = modelViewMat * vPosition;
+    vec4 vertexInEye = modelViewMat[instance] * vPosition;
     vec4 lightInEye = viewMat * lightPosition;
 
     // "Correct" way to transform normals.  The normal matrix is the
     // inverse transpose of the upper left 3x3 submatrix of the modelView
-    // matrix (i.e., does not include translations).  THIS IS EXPENSIVE
-    // TO COMPUTE because of the inverse(), and should really be done in
-    // the application, not here.
-    mat3 normMat = inverse( transpose( mat3(modelViewMat) ) );
-    vec4 normalInEye = vec4( normMat * vNormal, 0.0 );
+    // matrix (i.e., does not include translations); it is expensive to
+    // compute, so the application does it once per object.
+    vec4 normalInEye = vec4( normalMat[instance] * vNormal, 0.0 );
 
     // pass our vertex data to the fragment shader
     lPos = lightInEye.xyz;
@@ -70,5 +77,5 @@ void main()
     vNorm = normalInEye.xyz;
 
     // send the vertex position into clip space
-    gl_Position =  projMat * modelViewMat * vPosition;
+    gl_Position =  mvpMat[instance] * vPosition;
 }
@@ -0,0 +1,88 @@
+#version 150
+
+//
+// Phong vertex shader which builds its own modelView and normal
+// matrices for every vertex
+//
+// This is the previous version of p150.vert, kept so that the
+// transformation benchmark (--transforms) can compare the two.
+//
+// @author  RIT CS Department
+//
+
+//
+// INCOMING DATA
+//
+
+//
+// Vertex attributes
+//
+
+// Vertex position (in model space)
+in vec4 vPosition;
+
+// Normal vector at vertex (in model space)
+in vec3 vNormal;
+
+// Texture coordinate for this vertex
+in vec2 vTexCoord;
+
+//
+// Uniform data
+//
+
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Model transformation for each instance (a single object
+// drawn without instancing uses the first entry)
+uniform mat4 modelMat[8];
+
+//
+// OUTGOING DATA
+//
+
+// Vectors to "attach" to vertex and get sent to fragment shader
+// Vectors and points will be passed in "eye" space
+out vec3 lPos;
+out vec3 vPos;
+out vec3 vNorm;
+
+// Which instance this vertex belongs to
+flat out int instance;
+
+void main()
+{
+    instance = gl_InstanceID;
+
+    // create the modelview matrix
+    mat4 modelViewMat = viewMat * modelMat[instance];
+
+    // All vectors need to be converted to "eye" space
+    // All vectors should also be normalized
+    vec4 vertexInEye = modelViewMat * vPosition;
+    vec4 lightInEye = viewMat * lightPosition;
+
+    // "Correct" way to transform normals.  The normal matrix is the
+    // inverse transpose of the upper left 3x3 submatrix of the modelView
+    // matrix (i.e., does not include translations).  THIS IS EXPENSIVE
+    // TO COMPUTE because of the inverse(), and should really be done in
+    // the application, not here.
+    mat3 normMat = inverse( transpose( mat3(modelViewMat) ) );
+    vec4 normalInEye = vec4( normMat * vNormal, 0.0 );
+
+    // pass our vertex data to the fragment shader
+    lPos = lightInEye.xyz;
+    vPos = vertexInEye.xyz;
+    vNorm = normalInEye.xyz;
+
+    // send the vertex position into clip space
+    gl_Position =  projMat * modelViewMat * vPosition;
+}
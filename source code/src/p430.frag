@@ -0,0 +1,93 @@
+#version 430
+
+//
+// Phong fragment shader for multi-draw rendering
+//
+// Identical to p150.frag, except that the material colors come from
+// the per-object data.
+//
+
+//
+// INCOMING DATA
+//
+
+//
+// Data coming from the vertex shader
+//
+
+// Light position
+in vec3 lPos;
+
+// Vertex position (in clip space)
+in vec3 vPos;
+
+// Vertex normal
+in vec3 vNorm;
+
+// Which object this fragment belongs to
+flat in int objIndex;
+
+//
+// Data coming from the application
+//
+
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Material properties shared by all objects
+uniform vec4 specularColor;
+uniform vec3 kCoeff;
+
+// Per-object data (must match MDObject in Application.cpp)
+struct ObjectData {
+    mat4 modelViewMat;      // view * model
+    mat4 mvpMat;            // projection * view * model
+    mat3 normalMat;         // inverse transpose of modelView
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    float specExp;
+    int layer;
+};
+
+layout(std140) uniform Objects {
+    ObjectData objects[64];
+};
+
+// OUTGOING DATA
+
+// The final fragment color
+out vec4 fragColor;
+
+void main()
+{
+    // calculate lighting vectors
+    vec3 L = normalize( lPos - vPos );
+    vec3 N = normalize( vNorm );
+    vec3 R = normalize( reflect(-L, N) );
+    vec3 V = normalize( -(vPos) );
+
+    vec4 ambient  = vec4(0.0);  // ambient color component
+    vec4 diffuse  = vec4(0.0);  // diffuse color component
+    vec4 specular = vec4(0.0);  // specular color component
+    float specDot;  // specular dot(R,V) ^ specExp value
+
+    // old, Phong calculations
+    ambient  = ambientLight * objects[objIndex].ambientColor;
+    diffuse  = lightColor * objects[objIndex].diffuseColor * max(dot(N,L),0.0);
+    specDot  = pow( max(dot(R,V),0.0), objects[objIndex].specExp );
+    specular = lightColor * specularColor * specDot;
+
+    // calculate the final color
+    vec4 color = (kCoeff.x * ambient) +
+                 (kCoeff.y * diffuse) +
+                 (kCoeff.z * specular);
+
+    fragColor = color;
+}
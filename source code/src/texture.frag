@@ -9,17 +9,28 @@ in vec3 lPos;
 in vec3 vPos;
 in vec3 vNorm;
 in vec2 texCoord;
+flat in int instance;
+
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
 
 // Data coming from the application
-uniform vec4 lightColor;
-uniform vec4 ambientLight;
 uniform vec4 diffuseColor;
 uniform vec4 ambientColor;
 uniform vec4 specularColor;
-uniform float specExp;
+uniform float specExp[8];   // per instance
 uniform vec3 kCoeff;
-uniform sampler2D texturefront;
-uniform sampler2D textureback;
+uniform sampler2DArray textures;
+uniform int layer[8];       // per instance
+uniform sampler2DArray backTexture;     // shared by all the back faces
+uniform int backLayer;
 
 // OUTGOING DATA
 out vec4 fragColor;
@@ -37,20 +48,16 @@ void main()
     vec4 specular = vec4(0.0);  // specular color component
     float specDot;  // specular dot(R,V) ^ specExp value
 
-    if (gl_FrontFacing)
-    {
-        ambient = ambientLight * texture(texturefront, texCoord) * max(dot(N, L), 0.0);
-        diffuse = lightColor * texture(texturefront, texCoord);
-        specDot = pow(max(dot(R, V), 0.0), specExp);
-        specular = lightColor * texture(texturefront, texCoord) * specDot;
-    }
-    else
-    {
-        ambient = ambientLight * texture(textureback, texCoord) * max(dot(N, L), 0.0);
-        diffuse = lightColor * texture(textureback, texCoord);
-        specDot = pow(max(dot(R, V), 0.0), specExp);
-        specular = lightColor * texture(textureback, texCoord) * specDot;
-    }
+    // back faces all show the same texture (see backFile in
+    // Materials.cpp)
+    vec4 texel = gl_FrontFacing ?
+        texture(textures, vec3(texCoord, layer[instance])) :
+        texture(backTexture, vec3(texCoord, backLayer));
+
+    ambient = ambientLight * texel * max(dot(N, L), 0.0);
+    diffuse = lightColor * texel;
+    specDot = pow(max(dot(R, V), 0.0), specExp[instance]);
+    specular = lightColor * texel * specDot;
 
     // final color
     vec4 color = (kCoeff.x * ambient) +
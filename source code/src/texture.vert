@@ -25,13 +25,21 @@ in vec2 vTexCoord;
 
 
 // Uniform data
-// Camera and projection matrices
-uniform mat4 viewMat;   // view (camera)
-uniform mat4 projMat;   // projection
-uniform mat4 modelMat;  // composite
-
-// Light position is given in world space
-uniform vec4 lightPosition;
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Transformations for each instance (a single object drawn without
+// instancing uses the first entry), computed by the application
+uniform mat4 modelViewMat[8];   // view * model
+uniform mat4 mvpMat[8];         // projection * view * model
+uniform mat3 normalMat[8];      // inverse transpose of modelView
 
 // OUTGOING DATA
 
@@ -44,25 +52,27 @@ out vec3 vNorm;
 // ADD ANY OUTGOING VARIABLES YOU NEED HERE
 out vec2 texCoord; 
 
+// Which instance this vertex belongs to
+flat out int instance;
+
 void main()
 {
-    // create the modelview matrix
-    mat4 modelViewMat = viewMat * modelMat;
+    instance = gl_InstanceID;
 
     // All vectors need to be converted to "eye" space
     // All vectors should also be normalize
-    vec4 vertexInEye = modelViewMat * vPosition;
+    vec4 vertexInEye = modelViewMat[instance] * vPosition;
     vec4 lightInEye = viewMat * lightPosition;
     
-    mat3 normMat = inverse( transpose( mat3(modelViewMat) ) );
-    vec4 normalInEye = vec4( normMat * vNormal, 0.0 );
+    // the normal matrix comes from the application
+    vec4 normalInEye = vec4( normalMat[instance] * vNormal, 0.0 );
 
     // pass our vertex data to the fragment shader
     lPos = lightInEye.xyz;
     vPos = vertexInEye.xyz;
     vNorm = normalInEye.xyz;
 
-    gl_Position =  projMat * modelViewMat *  vPosition;
+    gl_Position =  mvpMat[instance] *  vPosition;
 
 
     // Add any code you need to implement texture mapping here.
@@ -0,0 +1,88 @@
+#version 430
+// Texture fragment shader for multi-draw rendering
+//
+// Identical to texture.frag, except that the front face texture's
+// layer is chosen from the per-object data.
+
+// @author  RIT CS Department
+// @author  Cinto Alapatt
+
+// INCOMING DATA
+
+// Data coming from the vertex shader
+in vec3 lPos;
+in vec3 vPos;
+in vec3 vNorm;
+in vec2 texCoord;
+flat in int objIndex;
+
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Data coming from the application
+uniform vec3 kCoeff;
+
+// the texture array of this draw call's objects (set per call, so it
+// is the same for every object the call draws)
+uniform sampler2DArray textures;
+
+// the texture shared by all the back faces
+uniform sampler2DArray backTexture;
+uniform int backLayer;
+
+// Per-object data (must match MDObject in Application.cpp)
+struct ObjectData {
+    mat4 modelViewMat;      // view * model
+    mat4 mvpMat;            // projection * view * model
+    mat3 normalMat;         // inverse transpose of modelView
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    float specExp;
+    int layer;
+};
+
+layout(std140) uniform Objects {
+    ObjectData objects[64];
+};
+
+// OUTGOING DATA
+out vec4 fragColor;
+
+void main()
+{
+    // calculate lighting vectors
+    vec3 L = normalize(lPos - vPos);
+    vec3 N = normalize(vNorm);
+    vec3 R = normalize(reflect(-L, N));
+    vec3 V = normalize(-vPos);
+
+    vec4 ambient  = vec4(0.0);  // ambient color component
+    vec4 diffuse  = vec4(0.0);  // diffuse color component
+    vec4 specular = vec4(0.0);  // specular color component
+    float specDot;  // specular dot(R,V) ^ specExp value
+
+    // back faces all show the same texture (see backFile in
+    // Materials.cpp)
+    vec4 texel = gl_FrontFacing ?
+        texture(textures, vec3(texCoord, objects[objIndex].layer)) :
+        texture(backTexture, vec3(texCoord, backLayer));
+
+    ambient = ambientLight * texel * max(dot(N, L), 0.0);
+    diffuse = lightColor * texel;
+    specDot = pow(max(dot(R, V), 0.0), objects[objIndex].specExp);
+    specular = lightColor * texel * specDot;
+
+    // final color
+    vec4 color = (kCoeff.x * ambient) +
+                  (kCoeff.y * diffuse) +
+                  (kCoeff.z * specular);
+
+    fragColor = color;
+}
@@ -0,0 +1,86 @@
+#version 430
+#extension GL_ARB_shader_draw_parameters : require
+
+// Texture vertex shader for multi-draw rendering
+//
+// Identical to texture.vert, except that the transformations come
+// from the per-object data selected by the draw ID.
+
+// @author  RIT CS Department
+// @author  Cinto Alapatt
+
+
+// Vertex attributes
+
+
+// Vertex position (in model space)
+in vec4 vPosition;
+
+// Normal vector at vertex (in model space)
+in vec3 vNormal;
+
+// Texture coordinate for this vertex
+in vec2 vTexCoord;
+
+
+// Uniform data
+// Per-frame camera, projection, and lighting data shared by all
+// the programs (must match FrameData in FrameData.cpp)
+layout(std140) uniform Frame {
+    mat4 viewMat;         // view (camera)
+    mat4 projMat;         // projection
+    vec4 lightPosition;   // light position (world space)
+    vec4 lightColor;
+    vec4 ambientLight;
+};
+
+// Index of the first object drawn with this program
+uniform int objectBase;
+
+// Per-object data (must match MDObject in Application.cpp)
+struct ObjectData {
+    mat4 modelViewMat;      // view * model
+    mat4 mvpMat;            // projection * view * model
+    mat3 normalMat;         // inverse transpose of modelView
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    float specExp;
+    int layer;
+};
+
+layout(std140) uniform Objects {
+    ObjectData objects[64];
+};
+
+// OUTGOING DATA
+
+// Vectors to "attach" to vertex and get sent to fragment shader
+// Vectors and points will be passed in "eye" space
+out vec3 lPos;
+out vec3 vPos;
+out vec3 vNorm;
+out vec2 texCoord;
+
+// Which object this vertex belongs to
+flat out int objIndex;
+
+void main()
+{
+    objIndex = objectBase + gl_DrawIDARB;
+
+    // All vectors need to be converted to "eye" space
+    // All vectors should also be normalize
+    vec4 vertexInEye = objects[objIndex].modelViewMat * vPosition;
+    vec4 lightInEye = viewMat * lightPosition;
+
+    vec4 normalInEye = vec4( objects[objIndex].normalMat * vNormal, 0.0 );
+
+    // pass our vertex data to the fragment shader
+    lPos = lightInEye.xyz;
+    vPos = vertexInEye.xyz;
+    vNorm = normalInEye.xyz;
+
+    gl_Position =  objects[objIndex].mvpMat *  vPosition;
+
+    texCoord = vTexCoord;
+}